@@ -3,11 +3,17 @@ import requests
 import os
 import sys
 import argparse
+import json
 
 ELEVENLABS_API_KEY = os.environ.get("ELEVENLABS_API_KEY")  # store key in env var
 
 VOICE_ID = "x2KkLbMTgqzRSatglGbk" # <- Tarmo Häälest tehtud
 
+serving = False # in --serve mode stdout carries only protocol lines
+
+# one HTTP session for all requests, keeps the connection to the API open in --serve mode
+session = requests.Session()
+
 def generate_audio(text: str, output_path: str):
     """Generate speech from text and save as MP3 file."""
     if not ELEVENLABS_API_KEY:
@@ -30,13 +36,49 @@ def generate_audio(text: str, output_path: str):
         }
     }
 
-    response = requests.post(url, headers=headers, json=data)
+    response = session.post(url, headers=headers, json=data)
     response.raise_for_status()
 
-    with open(output_path, "wb") as f:
+    # Write a new file and rename it into place: a cloned project may hard-link the old
+    # file, and replacing the directory entry leaves that project's audio untouched
+    tmp_path = output_path + ".tmp"
+    with open(tmp_path, "wb") as f:
         f.write(response.content)
+    os.replace(tmp_path, output_path)
+
+    print(f"✅ Saved: {output_path}", file=sys.stderr if serving else sys.stdout)
 
-    print(f"✅ Saved: {output_path}")
+def output_path_for(directory: str, filename: str) -> str:
+    """Path of <audio>/<directory>/<filename>.mp3, creating the directory if needed."""
+    # Get the script's directory (audio/)
+    script_dir = os.path.dirname(os.path.abspath(__file__))
+    
+    # Create full subdirectory path if it doesn't exist (supports nested dirs)
+    save_dir = os.path.join(script_dir, directory)
+    os.makedirs(save_dir, exist_ok=True)
+    
+    return os.path.join(save_dir, f"{filename}.mp3")
+
+def serve():
+    """Persistent worker for the server: one JSON request per line on stdin, one JSON response per line on stdout.
+
+    request:  {"id": 1, "text": "...", "dir": "audiofiles/project", "name": "cue"}
+    response: {"id": 1, "ok": true} or {"id": 1, "ok": false, "error": "..."}
+    """
+    global serving
+    serving = True
+    for line in sys.stdin:
+        if not line.strip():
+            continue
+        request_id = None
+        try:
+            request = json.loads(line)
+            request_id = request.get("id")
+            generate_audio(request["text"], output_path_for(request["dir"], request["name"]))
+            response = {"id": request_id, "ok": True}
+        except Exception as e:
+            response = {"id": request_id, "ok": False, "error": str(e)}
+        print(json.dumps(response), flush=True)
 
 def main():
     parser = argparse.ArgumentParser(description='Generate TTS audio using ElevenLabs API')
@@ -46,21 +88,17 @@ def main():
     
     args = parser.parse_args()
     
-    # Get the script's directory (audio/)
-    script_dir = os.path.dirname(os.path.abspath(__file__))
-    
-    # Create full subdirectory path if it doesn't exist (supports nested dirs)
-    save_dir = os.path.join(script_dir, args.channel)
-    os.makedirs(save_dir, exist_ok=True)
-    
     # Construct output path
-    output_path = os.path.join(save_dir, f"{args.filename}.mp3")
+    output_path = output_path_for(args.channel, args.filename)
     
     # Generate audio
     generate_audio(args.text, output_path)
     
 if __name__ == "__main__":
-    if len(sys.argv) > 1:
+    if len(sys.argv) == 2 and sys.argv[1] == "--serve":
+        # Worker mode, started once by the server
+        serve()
+    elif len(sys.argv) > 1:
         # Command-line mode with arguments
         main()
     else:
@@ -1,14 +1,56 @@
 // Copyright (C) 2016 Kurt Pattyn <pattyn.kurt@gmail.com>.
 // SPDX-License-Identifier: LicenseRef-Qt-Commercial OR BSD-3-Clause
 #include <QtCore/QCoreApplication>
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QLoggingCategory>
 #include "solarisserver.h"
+#include "solarisproject.h"
 
 int main(int argc, char *argv[])
 {
     QCoreApplication a(argc, argv);
-    SolarisServer server(1234);
 
-    Q_UNUSED(server);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Solaris performance server");
+    parser.addHelpOption();
+    QCommandLineOption recordOption("record", "Record the show (ticks, sent and received messages) into a binary log.", "file");
+    QCommandLineOption replayOption("replay", "Replay a show log offline as fast as possible and print dispatch timings.", "file");
+    QCommandLineOption ttsOption("tts", "Text-to-speech backend: worker (persistent generator.py process) or mock (offline synthetic audio).", "backend", "worker");
+    QCommandLineOption benchmarkTtsOption("benchmark-tts", "Generate the given number of cues with the selected TTS backend and print the throughput.", "count");
+    QCommandLineOption benchmarkLoadOption("benchmark-load", "Compare JSON and compiled project load time, memory and tick lookup for a project file.", "file");
+    parser.addOption(recordOption);
+    parser.addOption(replayOption);
+    parser.addOption(benchmarkLoadOption);
+    parser.addOption(ttsOption);
+    parser.addOption(benchmarkTtsOption);
+    parser.process(a);
+
+    if (parser.isSet(benchmarkLoadOption)) {
+        return SolarisProject::benchmarkLoad(parser.value(benchmarkLoadOption));
+    }
+
+    if (parser.isSet(replayOption)) {
+        // keep per-message debug output out of the timings
+        QLoggingCategory::setFilterRules("default.debug=false");
+        SolarisServer server(0);
+        return server.replay(parser.value(replayOption));
+    }
+
+    if (parser.isSet(benchmarkTtsOption)) {
+        SolarisServer server(0);
+        if (!server.setTtsBackend(parser.value(ttsOption))) {
+            return 1;
+        }
+        return server.benchmarkTts(parser.value(benchmarkTtsOption).toInt());
+    }
+
+    SolarisServer server(1234);
+    if (!server.setTtsBackend(parser.value(ttsOption))) {
+        return 1;
+    }
+    if (parser.isSet(recordOption)) {
+        server.startRecording(parser.value(recordOption));
+    }
 
     return a.exec();
 }
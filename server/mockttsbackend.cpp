@@ -0,0 +1,75 @@
+#include "mockttsbackend.h"
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSaveFile>
+#include <QtCore/QDataStream>
+#include <QtCore/QHash>
+#include <QtCore/QtMath>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrentRun>
+
+MockTtsBackend::MockTtsBackend(const QString &audioDir, QObject *parent) :
+    TtsBackend(audioDir, parent)
+{
+}
+
+QString MockTtsBackend::name() const
+{
+    return "mock";
+}
+
+quint64 MockTtsBackend::generate(const QString &text, const QString &subdir, const QString &fileName)
+{
+    quint64 id = nextId++;
+    QString path = outputPath(subdir, fileName);
+
+    auto *watcher = new QFutureWatcher<QString>(this);
+    connect(watcher, &QFutureWatcher<QString>::finished, this, [this, watcher, id]() {
+        watcher->deleteLater();
+        QString error = watcher->result();
+        emit finished(id, error.isEmpty(), error);
+    });
+    watcher->setFuture(QtConcurrent::run([text, path]() {
+        return writeFile(path, synthesize(text));
+    }));
+    return id;
+}
+
+QByteArray MockTtsBackend::synthesize(const QString &text)
+{
+    // 16-bit mono PCM, about 60 ms per character
+    int samples = qBound(MOCK_SAMPLE_RATE / 2, text.size() * MOCK_SAMPLE_RATE * 6 / 100, MOCK_SAMPLE_RATE * 10);
+    double frequency = 220 + qHash(text, 0) % 440;
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.writeRawData("RIFF", 4);
+    out << quint32(36 + samples * 2);
+    out.writeRawData("WAVEfmt ", 8);
+    out << quint32(16) << quint16(1) << quint16(1) << quint32(MOCK_SAMPLE_RATE)
+        << quint32(MOCK_SAMPLE_RATE * 2) << quint16(2) << quint16(16);
+    out.writeRawData("data", 4);
+    out << quint32(samples * 2);
+    for (int i = 0; i < samples; ++i) {
+        double fade = qMin(1.0, qMin(i, samples - i) / (MOCK_SAMPLE_RATE * 0.01)); // no clicks at the ends
+        out << qint16(8000 * fade * qSin(2 * M_PI * frequency * i / MOCK_SAMPLE_RATE));
+    }
+    return data;
+}
+
+QString MockTtsBackend::writeFile(const QString &path, const QByteArray &data)
+{
+    QDir().mkpath(QFileInfo(path).path());
+    // QSaveFile writes a temporary file and renames it over the target
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return "Cannot write " + path;
+    }
+    file.write(data);
+    if (!file.commit()) {
+        return "Cannot write " + path;
+    }
+    return QString();
+}
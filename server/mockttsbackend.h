@@ -0,0 +1,23 @@
+#ifndef MOCKTTSBACKEND_H
+#define MOCKTTSBACKEND_H
+
+#include "ttsbackend.h"
+
+#define MOCK_SAMPLE_RATE 8000
+
+// Offline stand-in for the TTS service: writes a short tone as WAV data (browsers sniff the
+// format, the .mp3 name is kept). Pitch and length depend only on the text, so output is deterministic.
+class MockTtsBackend : public TtsBackend
+{
+    Q_OBJECT
+public:
+    explicit MockTtsBackend(const QString &audioDir, QObject *parent = nullptr);
+
+    QString name() const override;
+    quint64 generate(const QString &text, const QString &subdir, const QString &fileName) override;
+
+    static QByteArray synthesize(const QString &text);
+    static QString writeFile(const QString &path, const QByteArray &data); // returns an error or empty
+};
+
+#endif //MOCKTTSBACKEND_H
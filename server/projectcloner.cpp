@@ -0,0 +1,89 @@
+#include "projectcloner.h"
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtConcurrent/QtConcurrentMap>
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+
+ProjectCloner::ProjectCloner(const QString &sourceDir, const QString &destDir, QObject *parent) :
+    QObject(parent),
+    sourceDir(sourceDir),
+    destDir(destDir)
+{
+    connect(&watcher, &QFutureWatcher<void>::progressValueChanged, this, [this](int value) {
+        emit progress(value, files.size());
+    });
+    connect(&watcher, &QFutureWatcher<void>::finished, this, &ProjectCloner::onFinished);
+}
+
+ProjectCloner::~ProjectCloner()
+{
+    // The worker threads use this object's members, e.g. when the server shuts down mid-clone
+    watcher.cancel();
+    watcher.waitForFinished();
+}
+
+void ProjectCloner::start()
+{
+    files = QDir(sourceDir).entryList(QStringList() << "*.mp3", QDir::Files);
+    if (files.isEmpty()) {
+        emit finished(0, 0, 0);
+        return;
+    }
+    QDir().mkpath(destDir);
+
+    watcher.setFuture(QtConcurrent::map(files, [this](const QString &fileName) {
+        Method method = cloneFile(sourceDir + "/" + fileName, destDir + "/" + fileName);
+        counts[method].ref();
+        if (method == Failed) {
+            qWarning() << "Failed to clone" << sourceDir + "/" + fileName << "to" << destDir;
+        }
+    }));
+}
+
+void ProjectCloner::onFinished()
+{
+    int linked = counts[Reflink].loadAcquire() + counts[HardLink].loadAcquire();
+    int copied = counts[Copy].loadAcquire();
+    int failed = counts[Failed].loadAcquire();
+    qDebug() << "Cloned" << files.size() << "audio file(s) from" << sourceDir << "to" << destDir
+             << "- reflinked:" << counts[Reflink].loadAcquire() << "hard-linked:" << counts[HardLink].loadAcquire()
+             << "copied:" << copied << "failed:" << failed;
+    emit finished(linked, copied, failed);
+}
+
+ProjectCloner::Method ProjectCloner::cloneFile(const QString &source, const QString &dest)
+{
+#if defined(Q_OS_LINUX) && defined(FICLONE)
+    // Copy-on-write clone (btrfs, XFS, ...): blocks are shared until one side is written
+    int in = ::open(QFile::encodeName(source).constData(), O_RDONLY | O_CLOEXEC);
+    if (in >= 0) {
+        int out = ::open(QFile::encodeName(dest).constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (out >= 0) {
+            bool cloned = ::ioctl(out, FICLONE, in) == 0;
+            ::close(out);
+            if (cloned) {
+                ::close(in);
+                return Reflink;
+            }
+            ::unlink(QFile::encodeName(dest).constData());
+        }
+        ::close(in);
+    }
+#endif
+#ifdef Q_OS_UNIX
+    // Hard link: both projects share the file until it is regenerated. generator.py writes
+    // a new file and renames it into place, so the other project keeps the old audio.
+    if (::link(QFile::encodeName(source).constData(), QFile::encodeName(dest).constData()) == 0) {
+        return HardLink;
+    }
+#endif
+    return QFile::copy(source, dest) ? Copy : Failed;
+}
@@ -0,0 +1,44 @@
+#ifndef PROJECTCLONER_H
+#define PROJECTCLONER_H
+
+#include <QtCore/QObject>
+#include <QtCore/QStringList>
+#include <QtCore/QAtomicInt>
+#include <QFutureWatcher>
+
+// Duplicates a project's audio directory in the background.
+// Each file is reflinked (copy-on-write) where the filesystem supports it, hard-linked
+// otherwise, and copied only as a last resort; files are processed in parallel.
+class ProjectCloner : public QObject
+{
+    Q_OBJECT
+public:
+    enum Method {
+        Reflink,
+        HardLink,
+        Copy,
+        Failed
+    };
+
+    explicit ProjectCloner(const QString &sourceDir, const QString &destDir, QObject *parent = nullptr);
+    ~ProjectCloner() override;
+
+    void start();
+    static Method cloneFile(const QString &source, const QString &dest);
+
+Q_SIGNALS:
+    void progress(int done, int total);
+    void finished(int linked, int copied, int failed);
+
+private Q_SLOTS:
+    void onFinished();
+
+private:
+    QString sourceDir;
+    QString destDir;
+    QStringList files;
+    QFutureWatcher<void> watcher;
+    QAtomicInt counts[Failed + 1];
+};
+
+#endif //PROJECTCLONER_H
@@ -0,0 +1,95 @@
+#include "showrecorder.h"
+#include <QtCore/QDebug>
+
+ShowRecorder::ShowRecorder(QObject *parent) :
+    QObject(parent)
+{
+}
+
+ShowRecorder::~ShowRecorder()
+{
+    close();
+}
+
+bool ShowRecorder::open(const QString &fileName)
+{
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Failed to open show log for writing:" << fileName;
+        return false;
+    }
+    out.setDevice(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << quint32(SHOWRECORDER_MAGIC) << quint16(SHOWRECORDER_VERSION);
+    clock.start();
+    qDebug() << "Recording show to" << fileName;
+    return true;
+}
+
+void ShowRecorder::close()
+{
+    if (file.isOpen()) {
+        file.close();
+    }
+}
+
+void ShowRecorder::record(RecordType type, const QString &room, const void *client, const QString &payload)
+{
+    if (!file.isOpen()) {
+        return;
+    }
+
+    quint32 clientId = 0;
+    if (client) {
+        clientId = clientIds.value(client);
+        if (!clientId) {
+            clientId = nextClientId++;
+            clientIds.insert(client, clientId);
+        }
+    }
+
+    out << quint8(type) << clock.nsecsElapsed() << room.toUtf8() << clientId << payload.toUtf8();
+
+    if (type == Disconnected) {
+        // a new connection may reuse the address
+        clientIds.remove(client);
+    } else if (type == Tick) {
+        file.flush(); // at most once a second, keeps the log usable after a crash
+    }
+}
+
+bool ShowRecorder::readHeader(QDataStream &in)
+{
+    quint32 magic = 0;
+    quint16 version = 0;
+    in.setVersion(QDataStream::Qt_5_0);
+    in >> magic >> version;
+    return in.status() == QDataStream::Ok && magic == SHOWRECORDER_MAGIC && version == SHOWRECORDER_VERSION;
+}
+
+bool ShowRecorder::readRecord(QDataStream &in, ShowRecord &record)
+{
+    if (in.atEnd()) {
+        return false;
+    }
+    QByteArray room, payload;
+    in >> record.type >> record.nsecs >> room >> record.client >> payload;
+    if (in.status() != QDataStream::Ok) {
+        return false;
+    }
+    record.room = QString::fromUtf8(room);
+    record.payload = QString::fromUtf8(payload);
+    return true;
+}
+
+QString ShowRecorder::typeName(quint8 type)
+{
+    switch (type) {
+    case Tick: return "tick";
+    case Sent: return "sent";
+    case Received: return "received";
+    case Connected: return "connected";
+    case Disconnected: return "disconnected";
+    default: return "unknown";
+    }
+}
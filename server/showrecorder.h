@@ -0,0 +1,57 @@
+#ifndef SHOWRECORDER_H
+#define SHOWRECORDER_H
+
+#include <QtCore/QObject>
+#include <QtCore/QFile>
+#include <QtCore/QDataStream>
+#include <QElapsedTimer>
+#include <QHash>
+
+#define SHOWRECORDER_MAGIC 0x534F4C52 // "SOLR"
+#define SHOWRECORDER_VERSION 1
+
+// One entry of a show log
+struct ShowRecord
+{
+    quint8 type = 0;
+    qint64 nsecs = 0; // monotonic time since recording started
+    QString room;
+    quint32 client = 0; // 0 - room/server itself, otherwise per-connection id
+    QString payload;
+};
+
+// Writes everything the server sends and receives during a show into a compact binary log:
+// header (magic, version) followed by records of
+// quint8 type, qint64 nsecs, QByteArray room, quint32 client, QByteArray payload (UTF-8)
+class ShowRecorder : public QObject
+{
+    Q_OBJECT
+public:
+    enum RecordType : quint8 {
+        Tick = 1,       // payload: counter value
+        Sent,           // payload: message broadcast to the room (client 0) or sent to one client
+        Received,       // payload: message from a client
+        Connected,      // payload: peer address
+        Disconnected
+    };
+
+    explicit ShowRecorder(QObject *parent = nullptr);
+    ~ShowRecorder() override;
+
+    bool open(const QString &fileName);
+    void close();
+    void record(RecordType type, const QString &room, const void *client, const QString &payload = QString());
+
+    static bool readHeader(QDataStream &in);
+    static bool readRecord(QDataStream &in, ShowRecord &record);
+    static QString typeName(quint8 type);
+
+private:
+    QFile file;
+    QDataStream out;
+    QElapsedTimer clock;
+    QHash<const void *, quint32> clientIds;
+    quint32 nextClientId = 1;
+};
+
+#endif //SHOWRECORDER_H
@@ -0,0 +1,969 @@
+#include "solarisproject.h"
+#include <QtCore/QDebug>
+#include <QtCore/QFile>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonArray>
+#include <QtCore/QByteArray>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+#define BENCHMARK_TICKS 300
+
+static QJsonObject unknownKeys(const QJsonObject &object, std::initializer_list<const char *> known)
+{
+    QJsonObject rest = object;
+    for (const char *key : known) {
+        rest.remove(QLatin1String(key));
+    }
+    return rest;
+}
+
+static bool isWholeTime(const QJsonValue &value)
+{
+    // toInt() only converts whole numbers in int range
+    return value.isDouble() && value.toDouble() == value.toInt();
+}
+
+static qint32 playbackTime(const QJsonValue &value)
+{
+    if (!value.isDouble()) {
+        return 0;
+    }
+    return qint32(qBound(-2147483648.0, std::floor(value.toDouble()), 2147483647.0));
+}
+
+static bool isStringArray(const QJsonValue &value)
+{
+    const QJsonArray array = value.toArray();
+    for (const QJsonValue &element : array) {
+        if (!element.isString()) {
+            return false;
+        }
+    }
+    return value.isArray();
+}
+
+// Takes a string member out of rest; any other type stays there as written
+static bool takeString(QJsonObject &rest, const char *key, QString &value)
+{
+    QJsonValue member = rest.value(QLatin1String(key));
+    if (!member.isString()) {
+        return false;
+    }
+    value = member.toString();
+    rest.remove(QLatin1String(key));
+    return true;
+}
+
+SolarisProject::SolarisProject() :
+    internCount(0),
+    sendToAll(false)
+{
+    addString(QString()); // id 0 is the empty string
+}
+
+SolarisProject SolarisProject::fromJson(const QJsonObject &json)
+{
+    SolarisProject project;
+
+    const QJsonArray commands = json.value("commands").toArray();
+    project.m_commands.reserve(commands.size());
+    for (const QJsonValue &value : commands) {
+        QJsonObject rest = value.toObject();
+        QString name, fileName, text;
+        Command command;
+        command.flags = 0;
+        if (!takeString(rest, "name", name)) {
+            command.flags |= RawCommandName;
+        }
+        if (!takeString(rest, "fileName", fileName)) {
+            command.flags |= RawFileName;
+        }
+        if (!takeString(rest, "text", text)) {
+            command.flags |= RawText;
+        }
+        command.name = project.intern(name);
+        command.fileName = project.addString(fileName);
+        command.text = project.addString(text);
+        project.appendCommand(command, rest);
+    }
+
+    const QJsonArray events = json.value("events").toArray();
+    project.m_events.reserve(events.size());
+    for (const QJsonValue &value : events) {
+        QJsonObject ev = value.toObject();
+        QJsonObject rest = ev;
+        QString name;
+        Event event;
+        event.flags = 0;
+        event.time = playbackTime(ev.value("time"));
+        if (isWholeTime(ev.value("time"))) {
+            rest.remove(QLatin1String("time"));
+        } else {
+            event.flags |= RawTime;
+        }
+        if (!takeString(rest, "name", name)) {
+            event.flags |= RawName;
+        }
+        event.name = project.intern(name);
+        event.firstChannel = project.channelTable.size();
+
+        // Handle both "channels" array and old "channel" string format
+        QJsonValue channels = ev.value("channels");
+        QJsonValue channel = ev.value("channel");
+        if (channels.isArray()) {
+            const QJsonArray channelsArray = channels.toArray();
+            for (const QJsonValue &chValue : channelsArray) {
+                project.channelTable.append(project.intern(chValue.toString()));
+            }
+            if (isStringArray(channels)) {
+                rest.remove(QLatin1String("channels"));
+            } else {
+                event.flags |= NoChannels;
+            }
+        } else if (ev.contains("channel")) {
+            project.channelTable.append(project.intern(channel.toString()));
+            if (channel.isString()) {
+                rest.remove(QLatin1String("channel"));
+                event.flags |= LegacyChannel;
+            } else {
+                event.flags |= NoChannels;
+            }
+        } else {
+            event.flags |= NoChannels;
+        }
+        event.channelCount = quint16(project.channelTable.size() - event.firstChannel);
+        project.appendEvent(event, rest);
+    }
+
+    project.sendToAll = json.value("sendToAll").toBool(false);
+    project.extra = unknownKeys(json, {"commands", "events", "sendToAll"});
+    project.resolveCommands();
+    project.buildIndex();
+    return project;
+}
+
+void SolarisProject::appendCommand(const Command &command, const QJsonObject &rest)
+{
+    int index = m_commands.size();
+    if (!commandByName.contains(command.name)) {
+        commandByName.insert(command.name, index); // first definition wins
+    }
+    if (!rest.isEmpty()) {
+        commandExtra.insert(index, rest);
+    }
+    m_commands.append(command);
+}
+
+void SolarisProject::appendEvent(const Event &event, const QJsonObject &rest)
+{
+    if (!rest.isEmpty()) {
+        eventExtra.insert(m_events.size(), rest);
+    }
+    m_events.append(event);
+}
+
+void SolarisProject::resolveCommands()
+{
+    // commands may follow events in the file, so resolve once everything is read
+    for (Event &event : m_events) {
+        event.command = findCommand(event.name);
+    }
+}
+
+QJsonObject SolarisProject::toJson() const
+{
+    QJsonObject json = extra;
+
+    QJsonArray commands;
+    for (int i = 0; i < m_commands.size(); ++i) {
+        const Command &command = m_commands.at(i);
+        QJsonObject cmd = commandExtra.value(i);
+        if (!(command.flags & RawCommandName)) {
+            cmd["name"] = string(command.name);
+        }
+        if (!(command.flags & RawFileName)) {
+            cmd["fileName"] = string(command.fileName);
+        }
+        if (!(command.flags & RawText)) {
+            cmd["text"] = string(command.text);
+        }
+        commands.append(cmd);
+    }
+
+    QJsonArray events;
+    for (int i = 0; i < m_events.size(); ++i) {
+        const Event &event = m_events.at(i);
+        QJsonObject ev = eventExtra.value(i);
+        if (!(event.flags & RawTime)) {
+            ev["time"] = event.time;
+        }
+        if (!(event.flags & RawName)) {
+            ev["name"] = string(event.name);
+        }
+        if (event.flags & LegacyChannel) {
+            ev["channel"] = string(channelTable.at(event.firstChannel));
+        } else if (!(event.flags & NoChannels)) {
+            ev["channels"] = QJsonArray::fromStringList(channels(event));
+        }
+        events.append(ev);
+    }
+
+    json["commands"] = commands;
+    json["events"] = events;
+    json["sendToAll"] = sendToAll;
+    return json;
+}
+
+QString SolarisProject::string(quint32 id) const
+{
+    const StringRef &ref = strings.at(id);
+    return QString::fromUtf8(arena.constData() + ref.offset, ref.length);
+}
+
+quint32 SolarisProject::addString(const QString &value)
+{
+    if (value.isEmpty() && !strings.isEmpty()) {
+        return 0;
+    }
+    return addUtf8(value.toUtf8());
+}
+
+quint32 SolarisProject::addUtf8(const QByteArray &utf8)
+{
+    StringRef ref;
+    ref.offset = arena.size();
+    ref.length = utf8.size();
+    arena.append(utf8);
+    strings.append(ref);
+    return strings.size() - 1;
+}
+
+quint32 SolarisProject::intern(const QString &value)
+{
+    if (value.isEmpty()) {
+        return 0;
+    }
+    // Keys are the strings already in the arena, so names and channels are stored only once
+    if ((internCount + 1) * 2 > internSlots.size()) {
+        rehashInterned(qMax(16, internSlots.size() * 2));
+    }
+    QByteArray utf8 = value.toUtf8();
+    uint mask = uint(internSlots.size() - 1);
+    uint slot = qHashBits(utf8.constData(), size_t(utf8.size())) & mask;
+    while (quint32 id = internSlots.at(int(slot))) {
+        const StringRef &ref = strings.at(id);
+        if (ref.length == quint32(utf8.size()) && memcmp(arena.constData() + ref.offset, utf8.constData(), ref.length) == 0) {
+            return id;
+        }
+        slot = (slot + 1) & mask;
+    }
+    quint32 id = addUtf8(utf8);
+    internSlots[int(slot)] = id;
+    internCount++;
+    return id;
+}
+
+void SolarisProject::rehashInterned(int size)
+{
+    QVector<quint32> old = internSlots;
+    internSlots = QVector<quint32>(size, 0);
+    uint mask = uint(size - 1);
+    for (quint32 id : old) {
+        if (!id) {
+            continue;
+        }
+        const StringRef &ref = strings.at(id);
+        uint slot = qHashBits(arena.constData() + ref.offset, ref.length) & mask;
+        while (internSlots.at(int(slot))) {
+            slot = (slot + 1) & mask;
+        }
+        internSlots[int(slot)] = id;
+    }
+}
+
+const QVector<SolarisProject::Command> &SolarisProject::commands() const
+{
+    return m_commands;
+}
+
+const QVector<SolarisProject::Event> &SolarisProject::events() const
+{
+    return m_events;
+}
+
+QStringList SolarisProject::channels(const Event &event) const
+{
+    QStringList channelsList;
+    for (quint32 i = event.firstChannel; i < event.firstChannel + event.channelCount; ++i) {
+        channelsList.append(string(channelTable.at(i)));
+    }
+    return channelsList;
+}
+
+void SolarisProject::buildIndex()
+{
+    byTime.resize(m_events.size());
+    for (int i = 0; i < byTime.size(); ++i) {
+        byTime[i] = i;
+    }
+    // stable: events at the same time keep their order from the file
+    std::stable_sort(byTime.begin(), byTime.end(), [this](quint32 a, quint32 b) {
+        return m_events.at(a).time < m_events.at(b).time;
+    });
+}
+
+int SolarisProject::lowerBound(qint32 time) const
+{
+    auto it = std::lower_bound(byTime.constBegin(), byTime.constEnd(), time, [this](quint32 index, qint32 value) {
+        return m_events.at(index).time < value;
+    });
+    return int(it - byTime.constBegin());
+}
+
+const SolarisProject::Event &SolarisProject::eventByTime(int position) const
+{
+    return m_events.at(byTime.at(position));
+}
+
+int SolarisProject::eventCount() const
+{
+    return m_events.size();
+}
+
+bool SolarisProject::isSendToAll() const
+{
+    return sendToAll;
+}
+
+void SolarisProject::setSendToAll(bool value)
+{
+    sendToAll = value;
+}
+
+int SolarisProject::findCommand(quint32 name) const
+{
+    return commandByName.value(name, -1);
+}
+
+void SolarisProject::setCommand(const QString &name, const QString &fileName, const QString &text)
+{
+    // Replaced strings stay in the arena until the project is loaded again
+    Command command;
+    command.name = intern(name);
+    command.fileName = addString(fileName);
+    command.text = addString(text);
+    command.flags = 0;
+
+    int index = findCommand(command.name);
+    if (index != -1) {
+        m_commands[index] = command;
+        commandExtra.remove(index);
+    } else {
+        index = m_commands.size();
+        m_commands.append(command);
+        commandByName.insert(command.name, index);
+        for (Event &event : m_events) {
+            if (event.name == command.name) {
+                event.command = index;
+            }
+        }
+    }
+}
+
+qint64 SolarisProject::memoryUsage() const
+{
+    // Approximate heap use: containers by capacity, hash nodes by entry
+    qint64 bytes = arena.capacity();
+    bytes += strings.capacity() * sizeof(StringRef);
+    bytes += m_commands.capacity() * sizeof(Command);
+    bytes += m_events.capacity() * sizeof(Event);
+    bytes += channelTable.capacity() * sizeof(quint32);
+    bytes += byTime.capacity() * sizeof(quint32);
+    bytes += internSlots.capacity() * sizeof(quint32);
+    bytes += commandByName.size() * (3 * sizeof(void *) + sizeof(quint32) + sizeof(int));
+    // Unknown keys are kept as JSON objects; their compact text is a fair estimate of their size
+    auto jsonSize = [](const QJsonObject &object) -> qint64 {
+        return object.isEmpty() ? 0 : QJsonDocument(object).toJson(QJsonDocument::Compact).size();
+    };
+    bytes += jsonSize(extra);
+    for (auto it = commandExtra.constBegin(); it != commandExtra.constEnd(); ++it) {
+        bytes += 3 * sizeof(void *) + sizeof(int) + sizeof(QJsonObject) + jsonSize(it.value());
+    }
+    for (auto it = eventExtra.constBegin(); it != eventExtra.constEnd(); ++it) {
+        bytes += 3 * sizeof(void *) + sizeof(int) + sizeof(QJsonObject) + jsonSize(it.value());
+    }
+    return bytes;
+}
+
+// Streaming reader for project files. Walks the (memory-mapped) UTF-8 text once and
+// appends commands and events directly to the project; only unknown keys become QJsonValues.
+class SolarisProjectReader
+{
+public:
+    SolarisProjectReader(const char *data, qint64 size, SolarisProject &project) :
+        begin(data), p(data), end(data + size), project(project)
+    {
+    }
+
+    bool read()
+    {
+        // UTF-8 byte order mark
+        if (end - p >= 3 && uchar(p[0]) == 0xEF && uchar(p[1]) == 0xBB && uchar(p[2]) == 0xBF) {
+            p += 3;
+        }
+        if (!expect('{')) {
+            return false;
+        }
+        QString key;
+        if (!firstMember(key)) {
+            return errorString.isEmpty();
+        }
+        do {
+            if (key == QLatin1String("commands")) {
+                if (!readArray(&SolarisProjectReader::readCommand)) {
+                    return false;
+                }
+            } else if (key == QLatin1String("events")) {
+                if (!readArray(&SolarisProjectReader::readEvent)) {
+                    return false;
+                }
+            } else {
+                QJsonValue value;
+                if (!readValue(value)) {
+                    return false;
+                }
+                if (key == QLatin1String("sendToAll")) {
+                    project.sendToAll = value.toBool(false);
+                } else {
+                    project.extra.insert(key, value);
+                }
+            }
+        } while (nextMember(key));
+        if (!errorString.isEmpty()) {
+            return false;
+        }
+        skipWhitespace();
+        if (p != end) {
+            return fail("garbage after the top-level object");
+        }
+        return true;
+    }
+
+    QString error() const
+    {
+        return errorString;
+    }
+
+private:
+    const char *begin;
+    const char *p;
+    const char *end;
+    SolarisProject &project;
+    QString errorString;
+
+    bool fail(const char *message)
+    {
+        if (errorString.isEmpty()) {
+            errorString = QString("%1 at offset %2").arg(message).arg(p - begin);
+        }
+        return false;
+    }
+
+    void skipWhitespace()
+    {
+        while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) {
+            ++p;
+        }
+    }
+
+    bool expect(char c)
+    {
+        skipWhitespace();
+        if (p >= end || *p != c) {
+            return fail(c == '{' ? "expected object" : c == '[' ? "expected array" : c == ':' ? "expected ':'" : "unexpected character");
+        }
+        ++p;
+        return true;
+    }
+
+    // Object members: call after '{'. Return false at the closing '}' or on error (errorString set).
+    bool firstMember(QString &key)
+    {
+        skipWhitespace();
+        if (p < end && *p == '}') {
+            ++p;
+            return false;
+        }
+        return readKey(key);
+    }
+
+    bool nextMember(QString &key)
+    {
+        skipWhitespace();
+        if (p < end && *p == ',') {
+            ++p;
+            return readKey(key);
+        }
+        if (p < end && *p == '}') {
+            ++p;
+            return false;
+        }
+        return fail("expected ',' or '}'");
+    }
+
+    bool readKey(QString &key)
+    {
+        skipWhitespace();
+        return readString(key) && expect(':');
+    }
+
+    bool readArray(bool (SolarisProjectReader::*readElement)())
+    {
+        if (!expect('[')) {
+            return false;
+        }
+        skipWhitespace();
+        if (p < end && *p == ']') {
+            ++p;
+            return true;
+        }
+        for (;;) {
+            if (!(this->*readElement)()) {
+                return false;
+            }
+            skipWhitespace();
+            if (p < end && *p == ',') {
+                ++p;
+            } else if (p < end && *p == ']') {
+                ++p;
+                return true;
+            } else {
+                return fail("expected ',' or ']'");
+            }
+        }
+    }
+
+    bool readCommand()
+    {
+        if (!expect('{')) {
+            return false;
+        }
+        QString name, fileName, text;
+        quint16 flags = SolarisProject::RawCommandName | SolarisProject::RawFileName | SolarisProject::RawText;
+        QJsonObject rest;
+        QString key;
+        if (firstMember(key)) {
+            do {
+                QJsonValue value;
+                if (!readValue(value)) {
+                    return false;
+                }
+                // Same rule as fromJson: only strings are taken, other values are kept as written
+                if (key == QLatin1String("name") && value.isString()) {
+                    name = value.toString();
+                    flags &= ~SolarisProject::RawCommandName;
+                } else if (key == QLatin1String("fileName") && value.isString()) {
+                    fileName = value.toString();
+                    flags &= ~SolarisProject::RawFileName;
+                } else if (key == QLatin1String("text") && value.isString()) {
+                    text = value.toString();
+                    flags &= ~SolarisProject::RawText;
+                } else {
+                    rest.insert(key, value);
+                }
+            } while (nextMember(key));
+        }
+        if (!errorString.isEmpty()) {
+            return false;
+        }
+
+        SolarisProject::Command command;
+        command.flags = flags;
+        command.name = project.intern(name);
+        command.fileName = project.addString(fileName);
+        command.text = project.addString(text);
+        project.appendCommand(command, rest);
+        return true;
+    }
+
+    bool readEvent()
+    {
+        if (!expect('{')) {
+            return false;
+        }
+        SolarisProject::Event event;
+        event.time = 0;
+        event.name = 0;
+        event.command = -1;
+        event.flags = SolarisProject::RawTime | SolarisProject::RawName; // until the file has them
+        QVector<quint32> channels, legacyChannel;
+        QJsonValue channelsValue, legacyValue;
+        QJsonObject rest;
+        QString key;
+        if (firstMember(key)) {
+            do {
+                QJsonValue value;
+                if (!readValue(value)) {
+                    return false;
+                }
+                // Same rule as fromJson: values of another type are kept as written
+                if (key == QLatin1String("time")) {
+                    event.time = playbackTime(value);
+                    if (isWholeTime(value)) {
+                        event.flags &= ~SolarisProject::RawTime;
+                    } else {
+                        rest.insert(key, value);
+                    }
+                } else if (key == QLatin1String("name") && value.isString()) {
+                    event.name = project.intern(value.toString());
+                    event.flags &= ~SolarisProject::RawName;
+                } else if (key == QLatin1String("channels") && value.isArray()) {
+                    channelsValue = value;
+                    const QJsonArray channelsArray = value.toArray();
+                    for (const QJsonValue &chValue : channelsArray) {
+                        channels.append(project.intern(chValue.toString()));
+                    }
+                } else if (key == QLatin1String("channel")) {
+                    legacyValue = value;
+                    legacyChannel = { project.intern(value.toString()) };
+                } else {
+                    rest.insert(key, value); // a "channels" that is not an array is kept as it was
+                }
+            } while (nextMember(key));
+        }
+        if (!errorString.isEmpty()) {
+            return false;
+        }
+
+        // Same precedence as fromJson: "channels" array first, old "channel" string otherwise
+        if (channelsValue.isArray()) {
+            if (!isStringArray(channelsValue)) {
+                rest.insert(QLatin1String("channels"), channelsValue);
+                event.flags |= SolarisProject::NoChannels;
+            }
+            if (!legacyValue.isUndefined()) {
+                rest.insert(QLatin1String("channel"), legacyValue);
+            }
+        } else if (!legacyValue.isUndefined()) {
+            channels = legacyChannel;
+            if (legacyValue.isString()) {
+                event.flags |= SolarisProject::LegacyChannel;
+            } else {
+                rest.insert(QLatin1String("channel"), legacyValue);
+                event.flags |= SolarisProject::NoChannels;
+            }
+        } else {
+            event.flags |= SolarisProject::NoChannels;
+        }
+        event.firstChannel = project.channelTable.size();
+        event.channelCount = quint16(channels.size());
+        project.channelTable.append(channels);
+        project.appendEvent(event, rest);
+        return true;
+    }
+
+    bool readValue(QJsonValue &value)
+    {
+        skipWhitespace();
+        if (p >= end) {
+            return fail("unexpected end of file");
+        }
+        switch (*p) {
+        case '"': {
+            QString string;
+            if (!readString(string)) {
+                return false;
+            }
+            value = string;
+            return true;
+        }
+        case '{': {
+            ++p;
+            QJsonObject object;
+            QString key;
+            if (firstMember(key)) {
+                do {
+                    QJsonValue member;
+                    if (!readValue(member)) {
+                        return false;
+                    }
+                    object.insert(key, member);
+                } while (nextMember(key));
+            }
+            value = object;
+            return errorString.isEmpty();
+        }
+        case '[': {
+            ++p;
+            QJsonArray array;
+            skipWhitespace();
+            if (p < end && *p == ']') {
+                ++p;
+            } else {
+                for (;;) {
+                    QJsonValue element;
+                    if (!readValue(element)) {
+                        return false;
+                    }
+                    array.append(element);
+                    skipWhitespace();
+                    if (p < end && *p == ',') {
+                        ++p;
+                    } else if (p < end && *p == ']') {
+                        ++p;
+                        break;
+                    } else {
+                        return fail("expected ',' or ']'");
+                    }
+                }
+            }
+            value = array;
+            return true;
+        }
+        case 't':
+            return readLiteral("true", QJsonValue(true), value);
+        case 'f':
+            return readLiteral("false", QJsonValue(false), value);
+        case 'n':
+            return readLiteral("null", QJsonValue(QJsonValue::Null), value);
+        default:
+            return readNumber(value);
+        }
+    }
+
+    bool readLiteral(const char *literal, const QJsonValue &literalValue, QJsonValue &value)
+    {
+        qint64 length = qstrlen(literal);
+        if (end - p < length || qstrncmp(p, literal, length) != 0) {
+            return fail("invalid literal");
+        }
+        p += length;
+        value = literalValue;
+        return true;
+    }
+
+    bool readNumber(QJsonValue &value)
+    {
+        const char *start = p;
+        while (p < end && ((*p >= '0' && *p <= '9') || *p == '-' || *p == '+' || *p == '.' || *p == 'e' || *p == 'E')) {
+            ++p;
+        }
+        bool ok = false;
+        double number = QByteArray::fromRawData(start, int(p - start)).toDouble(&ok);
+        if (!ok) {
+            p = start;
+            return fail("invalid number");
+        }
+        value = number;
+        return true;
+    }
+
+    bool readHex4(ushort &code)
+    {
+        if (end - p < 4) {
+            return false;
+        }
+        bool ok = false;
+        code = QByteArray::fromRawData(p, 4).toUShort(&ok, 16);
+        p += 4;
+        return ok;
+    }
+
+    bool readString(QString &value)
+    {
+        if (p >= end || *p != '"') {
+            return fail("expected string");
+        }
+        ++p;
+
+        // Fast path: no escapes, decode the mapped bytes directly
+        const char *start = p;
+        while (p < end && *p != '"' && *p != '\\') {
+            ++p;
+        }
+        if (p >= end) {
+            return fail("unterminated string");
+        }
+        value = QString::fromUtf8(start, int(p - start));
+        if (*p == '"') {
+            ++p;
+            return true;
+        }
+
+        // Escapes: decode chunk by chunk, \u escapes are UTF-16 code units already
+        while (p < end) {
+            if (*p == '"') {
+                ++p;
+                return true;
+            }
+            if (*p != '\\') {
+                start = p;
+                while (p < end && *p != '"' && *p != '\\') {
+                    ++p;
+                }
+                value.append(QString::fromUtf8(start, int(p - start)));
+                continue;
+            }
+            if (++p >= end) {
+                break;
+            }
+            char escape = *p++;
+            switch (escape) {
+            case '"': value.append(QLatin1Char('"')); break;
+            case '\\': value.append(QLatin1Char('\\')); break;
+            case '/': value.append(QLatin1Char('/')); break;
+            case 'b': value.append(QLatin1Char('\b')); break;
+            case 'f': value.append(QLatin1Char('\f')); break;
+            case 'n': value.append(QLatin1Char('\n')); break;
+            case 'r': value.append(QLatin1Char('\r')); break;
+            case 't': value.append(QLatin1Char('\t')); break;
+            case 'u': {
+                ushort code;
+                if (!readHex4(code)) {
+                    return fail("invalid \\u escape");
+                }
+                value.append(QChar(code));
+                break;
+            }
+            default:
+                return fail("invalid escape");
+            }
+        }
+        return fail("unterminated string");
+    }
+};
+
+SolarisProject SolarisProject::load(const QString &fileName, QString *error)
+{
+    SolarisProject project;
+    QString errorString;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        errorString = "cannot open file";
+    } else if (file.size() == 0) {
+        errorString = "empty file";
+    } else {
+        // Map instead of readAll(): no second copy of the file on the heap
+        qint64 size = file.size();
+        uchar *data = file.map(0, size);
+        QByteArray buffer;
+        if (!data) {
+            buffer = file.readAll(); // filesystems without mmap support
+        }
+        const char *text = data ? reinterpret_cast<const char *>(data) : buffer.constData();
+
+        SolarisProjectReader reader(text, data ? size : buffer.size(), project);
+        if (reader.read()) {
+            project.resolveCommands();
+            project.buildIndex();
+        } else {
+            errorString = reader.error();
+            project = SolarisProject();
+        }
+        if (data) {
+            file.unmap(data);
+        }
+    }
+
+    if (error) {
+        *error = errorString;
+    }
+    return project;
+}
+
+static qint64 residentMemory()
+{
+#ifdef Q_OS_LINUX
+    QFile statm("/proc/self/statm");
+    if (statm.open(QIODevice::ReadOnly)) {
+        QList<QByteArray> fields = statm.readAll().split(' ');
+        if (fields.size() > 1) {
+            return fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE);
+        }
+    }
+#endif
+    return -1;
+}
+
+int SolarisProject::benchmarkLoad(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCritical() << "Cannot open project file:" << fileName;
+        return 1;
+    }
+    QByteArray data = file.readAll();
+    file.close();
+
+    QElapsedTimer timer;
+    qint64 rssBefore = residentMemory();
+    timer.start();
+    QJsonDocument doc = QJsonDocument::fromJson(data);
+    QJsonObject json = doc.object();
+    qint64 parseNs = timer.nsecsElapsed();
+    qint64 jsonRss = residentMemory() - rssBefore;
+    if (doc.isNull() || !doc.isObject()) {
+        qCritical() << "Failed to parse" << fileName;
+        return 1;
+    }
+
+    timer.restart();
+    SolarisProject project = fromJson(json);
+    qint64 compileNs = timer.nsecsElapsed();
+
+    // Streaming loader on the same file: no DOM, no readAll()
+    QString loadError;
+    rssBefore = residentMemory();
+    timer.restart();
+    SolarisProject streamed = load(fileName, &loadError);
+    qint64 streamNs = timer.nsecsElapsed();
+    qint64 streamRss = residentMemory() - rssBefore;
+    if (!loadError.isEmpty()) {
+        qWarning() << "Streaming load failed:" << loadError;
+    }
+
+    // Per-tick lookup: old array scan against the time index, over the first BENCHMARK_TICKS seconds
+    QJsonArray events = json.value("events").toArray();
+    qint32 firstTime = project.eventCount() ? project.eventByTime(0).time : 0;
+    qint32 lastTime = project.eventCount() ? project.eventByTime(project.eventCount() - 1).time : 0;
+    lastTime = qMin(lastTime, firstTime + BENCHMARK_TICKS - 1);
+    int scanned = 0, indexed = 0;
+    timer.restart();
+    for (qint32 time = firstTime; time <= lastTime; ++time) {
+        for (const QJsonValue &value : events) {
+            if (value.toObject().value("time").toInt() == time) {
+                scanned++;
+            }
+        }
+    }
+    qint64 scanNs = timer.nsecsElapsed();
+    timer.restart();
+    for (qint32 time = firstTime; time <= lastTime; ++time) {
+        indexed += project.lowerBound(time + 1) - project.lowerBound(time);
+    }
+    qint64 indexNs = timer.nsecsElapsed();
+    int ticks = qMax(1, lastTime - firstTime + 1);
+
+    qInfo().noquote() << QString("%1: %2 bytes, %3 commands, %4 events")
+                         .arg(fileName).arg(data.size()).arg(project.commands().size()).arg(project.eventCount());
+    qInfo().noquote() << QString("  QJsonDocument parse: %1 ms, resident memory +%2 KiB")
+                         .arg(parseNs / 1e6, 0, 'f', 1).arg(jsonRss / 1024);
+    qInfo().noquote() << QString("  SolarisProject from JSON: %1 ms, model %2 KiB")
+                         .arg(compileNs / 1e6, 0, 'f', 1).arg(project.memoryUsage() / 1024);
+    qInfo().noquote() << QString("  SolarisProject::load (mapped, streaming): %1 ms, resident memory +%2 KiB, model %3 KiB, %4 events")
+                         .arg(streamNs / 1e6, 0, 'f', 1).arg(streamRss / 1024)
+                         .arg(streamed.memoryUsage() / 1024).arg(streamed.eventCount());
+    qInfo().noquote() << QString("  tick lookup over %1 ticks: array scan %2 us/tick, time index %3 us/tick (%4/%5 events)")
+                         .arg(ticks)
+                         .arg(scanNs / 1e3 / ticks, 0, 'f', 2)
+                         .arg(indexNs / 1e3 / ticks, 0, 'f', 3)
+                         .arg(scanned).arg(indexed);
+    return 0;
+}
@@ -0,0 +1,114 @@
+#ifndef SOLARISPROJECT_H
+#define SOLARISPROJECT_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QVector>
+#include <QtCore/QHash>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QJsonObject>
+
+// Typed in-memory project, the source of truth while the server runs.
+// JSON is only used at the load/save boundary (load/fromJson/toJson).
+// All strings live in one UTF-8 arena, command names and channels are interned,
+// events are kept in file order plus an index sorted by time.
+class SolarisProject
+{
+public:
+    struct Command
+    {
+        quint32 name;     // interned
+        quint32 fileName; // string id
+        quint32 text;     // string id
+        quint16 flags;
+    };
+
+    struct Event
+    {
+        qint32 time;
+        quint32 name;         // interned command name
+        qint32 command;       // index into commands(), -1 if the command is not defined
+        quint32 firstChannel; // range in the channel table
+        quint16 channelCount;
+        quint16 flags;
+    };
+
+    // A known key is only taken into the model when the file has it with the expected type.
+    // Otherwise the extra keys keep it as written, and the flag stops toJson from writing the model's value.
+    enum EventFlags : quint16 {
+        LegacyChannel = 1, // file used "channel": "x" instead of "channels": [...]
+        NoChannels = 2,    // no channel key is written back: the file had none, or only ones of other types
+        RawTime = 4,       // "time" missing or not a whole number; it plays at the second it falls in
+        RawName = 8        // "name" missing or not a string
+    };
+
+    enum CommandFlags : quint16 {
+        RawCommandName = 1,
+        RawFileName = 2,
+        RawText = 4
+    };
+
+    SolarisProject();
+
+    static SolarisProject fromJson(const QJsonObject &json);
+    // Streams a project file straight into the model: the file is memory-mapped and parsed
+    // without building a QJsonDocument. Safe to call from a worker thread.
+    static SolarisProject load(const QString &fileName, QString *error = nullptr);
+    QJsonObject toJson() const;
+
+    QString string(quint32 id) const;
+    quint32 intern(const QString &value);
+
+    const QVector<Command> &commands() const;
+    const QVector<Event> &events() const;
+    QStringList channels(const Event &event) const;
+
+    // Position in the time index of the first event with time >= given time
+    int lowerBound(qint32 time) const;
+    const Event &eventByTime(int position) const;
+    int eventCount() const;
+
+    bool isSendToAll() const;
+    void setSendToAll(bool value);
+
+    int findCommand(quint32 name) const;
+    void setCommand(const QString &name, const QString &fileName, const QString &text);
+
+    qint64 memoryUsage() const;
+    static int benchmarkLoad(const QString &fileName);
+
+private:
+    friend class SolarisProjectReader;
+
+    struct StringRef
+    {
+        quint32 offset;
+        quint32 length;
+    };
+
+    quint32 addString(const QString &value);
+    quint32 addUtf8(const QByteArray &utf8);
+    void rehashInterned(int size);
+    void appendCommand(const Command &command, const QJsonObject &rest);
+    void appendEvent(const Event &event, const QJsonObject &rest);
+    void resolveCommands();
+    void buildIndex();
+
+    QByteArray arena;
+    QVector<StringRef> strings;
+    QVector<quint32> internSlots; // open addressing over string ids (0 - empty), hashed by their UTF-8 bytes in the arena
+    int internCount;
+
+    QVector<Command> m_commands;
+    QVector<Event> m_events;
+    QVector<quint32> channelTable; // interned channel names, ranges referenced by events
+    QVector<quint32> byTime;       // event indices, stable-sorted by time
+    QHash<quint32, int> commandByName;
+
+    bool sendToAll;
+    QJsonObject extra;                     // unknown top-level keys, written back unchanged
+    QHash<int, QJsonObject> commandExtra;  // unknown keys per command index
+    QHash<int, QJsonObject> eventExtra;    // unknown keys per event index
+};
+
+#endif //SOLARISPROJECT_H
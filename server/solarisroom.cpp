@@ -0,0 +1,557 @@
+#include "solarisroom.h"
+#include "showrecorder.h"
+#include "QtWebSockets/QWebSocket"
+#include <QtCore/QDebug>
+#include <QtCore/QFile>
+#include <QtCore/QSaveFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QSet>
+#include <QtCore/QFutureWatcher>
+#include <QtConcurrent/QtConcurrentRun>
+
+QT_USE_NAMESPACE
+
+SolarisRoom::SolarisRoom(const QString &id, ProjectCache *projectCache, QObject *parent) :
+    QObject(parent),
+    roomId(id),
+    projectCache(projectCache),
+    counter(START_FROM),
+    lastTick(START_FROM),
+    tickedSinceSeek(false),
+    m_speed(1),
+    sendToAllChannels(false),
+    recorder(nullptr),
+    readOnly(false),
+    loadGeneration(0),
+    tickMessages(0),
+    tickFrames(0)
+{
+    timer.setInterval(qRound(1000/m_speed));
+    connect(&timer, SIGNAL(timeout()), this, SLOT(counterChanged()) );
+}
+
+QString SolarisRoom::id() const
+{
+    return roomId;
+}
+
+void SolarisRoom::addClient(QWebSocket *socket, ClientRole role)
+{
+    if (!m_clients.contains(socket)) {
+        m_clients << socket;
+    }
+    roles.insert(socket, role);
+}
+
+void SolarisRoom::setRole(QWebSocket *socket, ClientRole role)
+{
+    if (m_clients.contains(socket)) {
+        roles.insert(socket, role);
+    }
+}
+
+void SolarisRoom::removeClient(QWebSocket *socket)
+{
+    m_clients.removeAll(socket);
+    roles.remove(socket);
+}
+
+QList<QWebSocket *> SolarisRoom::clients() const
+{
+    return m_clients;
+}
+
+void SolarisRoom::start()
+{
+    timer.start();
+}
+
+void SolarisRoom::start(int time)
+{
+    counter = time;
+    tickedSinceSeek = false;
+    qDebug() << "Room" << roomId << "set time to: " << time;
+    timer.start();
+}
+
+void SolarisRoom::stop()
+{
+    timer.stop();
+    counter = START_FROM;
+    tickedSinceSeek = false;
+    // Send stop command to all clients to clear their displays
+    sendToAll("stop");
+}
+
+int SolarisRoom::seek(int time, bool chase)
+{
+    // lowerBound on the time index: the next tick picks up exactly at the new time
+    qDebug() << "Room" << roomId << "set time to: " << time << (chase ? "with chase" : "");
+    int from = counter; // next tick, its cues have not been played yet
+    counter = time;
+    tickedSinceSeek = false;
+
+    int skipped = 0;
+    if (time > from) {
+        skipped = project.lowerBound(time) - project.lowerBound(from);
+    }
+    qDebug() << "Room" << roomId << "skipped" << skipped << "cues";
+
+    // Chasing only makes sense while the show runs; a forward seek does not repeat cues played before it
+    if (chase && timer.isActive()) {
+        int windowStart = time > from ? qMax(from, time - CATCHUP_WINDOW) : time - CATCHUP_WINDOW;
+        QStringList frame;
+        frame << "time|" + QString::number(time);
+        frame << chaseMessages(windowStart, time);
+        qDebug() << "Room" << roomId << "chasing" << frame.size() - 1 << "cues";
+        sendFrame(frame);
+    }
+    return skipped;
+}
+
+bool SolarisRoom::isRunning() const
+{
+    return timer.isActive();
+}
+
+double SolarisRoom::speed() const
+{
+    return m_speed;
+}
+
+double SolarisRoom::setSpeed(double value)
+{
+    // Faster speeds shorten the tick interval; every show second still gets its own tick, so no cue is dropped
+    m_speed = qBound(MIN_SPEED, value, MAX_SPEED);
+    timer.setInterval(qRound(1000/m_speed));
+    qDebug() << "Room" << roomId << "speed set to" << m_speed;
+    return m_speed;
+}
+
+void SolarisRoom::loadSolarisJSON(const QString &fileName)
+{
+    // Any project switch supersedes a background load still in progress
+    ++loadGeneration;
+
+    // Rooms playing the same project share one compiled copy (its containers are implicitly shared)
+    if (isCached(fileName)) {
+        project = projectCache->value(fileName).project;
+        activeJSONFile = fileName;
+        sendToAllChannels = project.isSendToAll();
+        qDebug() << "Room" << roomId << "loaded" << fileName << "from cache";
+        return;
+    }
+
+    // A fresh room adopts the file even if it does not exist yet, so the first save creates it
+    if (activeJSONFile.isEmpty()) {
+        activeJSONFile = fileName;
+    }
+
+    QString error;
+    CachedProject loaded = stamp(fileName);
+    loaded.project = SolarisProject::load(fileName, &error);
+    if (QFile::exists(fileName)) {
+        if (error.isEmpty()) {
+            // JSON is only the file format; the room works on the compiled project
+            project = loaded.project;
+            activeJSONFile = fileName;
+            projectCache->insert(fileName, loaded);
+
+            // Load sendToAll flag
+            sendToAllChannels = project.isSendToAll();
+
+            qDebug() << "Successfully loaded" << fileName;
+            qDebug() << "sendToAllChannels:" << sendToAllChannels;
+        } else {
+            qWarning() << "Failed to parse" << fileName << error;
+            // Initialize with empty structure
+            project = SolarisProject();
+            sendToAllChannels = false;
+        }
+    } else {
+        qDebug() << fileName << "not found, creating new structure";
+        // Initialize with empty structure
+        project = SolarisProject();
+        sendToAllChannels = false;
+    }
+}
+
+void SolarisRoom::loadSolarisJSONAsync(const QString &fileName)
+{
+    // Cached projects need no parsing; replay has no event loop to deliver a background result
+    if (readOnly || isCached(fileName)) {
+        QElapsedTimer clock;
+        clock.start();
+        loadSolarisJSON(fileName);
+        emit projectLoaded(fileName, true, clock.elapsed());
+        return;
+    }
+
+    // Parse on a worker thread; the current project keeps playing until the swap below
+    quint64 generation = ++loadGeneration;
+    QElapsedTimer clock;
+    clock.start();
+    // stamped before parsing, so an edit during the load invalidates the entry
+    CachedProject loaded = stamp(fileName);
+    QSharedPointer<QString> error = QSharedPointer<QString>::create();
+    auto *watcher = new QFutureWatcher<SolarisProject>(this);
+    connect(watcher, &QFutureWatcher<SolarisProject>::finished, this, [this, watcher, fileName, generation, clock, error, loaded]() mutable {
+        watcher->deleteLater();
+        if (generation != loadGeneration) {
+            qDebug() << "Room" << roomId << "dropping superseded load of" << fileName;
+            return;
+        }
+        qint64 elapsed = clock.elapsed();
+        if (!error->isEmpty()) {
+            qWarning() << "Failed to load" << fileName << *error;
+            if (activeJSONFile.isEmpty()) {
+                activeJSONFile = fileName; // a fresh room adopts the file, as in loadSolarisJSON()
+            }
+            emit projectLoaded(fileName, false, elapsed);
+            return;
+        }
+
+        // Swap on the event loop thread: a tick sees either the old or the new project
+        project = watcher->result();
+        activeJSONFile = fileName;
+        sendToAllChannels = project.isSendToAll();
+        loaded.project = project;
+        projectCache->insert(fileName, loaded);
+        qDebug() << "Room" << roomId << "loaded" << fileName << "in" << elapsed << "ms";
+        emit projectLoaded(fileName, true, elapsed);
+    });
+    watcher->setFuture(QtConcurrent::run([fileName, error]() {
+        return SolarisProject::load(fileName, error.data());
+    }));
+}
+
+void SolarisRoom::refreshProject(const QString &fileName)
+{
+    // The saving room has just cached its copy; a background load of another file still wins when it finishes
+    if (fileName != activeJSONFile || !projectCache->contains(fileName)) {
+        return;
+    }
+    project = projectCache->value(fileName).project;
+    sendToAllChannels = project.isSendToAll();
+    qDebug() << "Room" << roomId << "refreshed" << fileName << "from cache";
+}
+
+void SolarisRoom::saveSolarisJSON()
+{
+    saveSolarisJSON(activeJSONFile);
+}
+
+void SolarisRoom::saveSolarisJSON(const QString &fileName)
+{
+    // Update sendToAll in the project before saving
+    project.setSendToAll(sendToAllChannels);
+
+    if (readOnly) {
+        CachedProject saved;
+        saved.project = project;
+        projectCache->insert(fileName, saved);
+        sendToEditors("dataUpdated");
+        emit projectSaved(fileName);
+        return;
+    }
+
+    // QSaveFile writes a new file and renames it into place: a background load that already
+    // mapped the old file keeps reading intact data instead of faulting past a truncated end
+    QSaveFile file(fileName);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        QJsonDocument doc(project.toJson());
+        file.write(doc.toJson(QJsonDocument::Indented));
+        if (!file.commit()) {
+            qWarning() << "Failed to write" << fileName << file.errorString();
+            return;
+        }
+        CachedProject saved = stamp(fileName);
+        saved.project = project;
+        projectCache->insert(fileName, saved);
+        qDebug() << "Successfully saved" << fileName;
+
+        // Notify editors that data has been updated
+        sendToEditors("dataUpdated");
+        emit projectSaved(fileName);
+    } else {
+        qWarning() << "Failed to open for writing:" << fileName;
+    }
+}
+
+QString SolarisRoom::activeFile() const
+{
+    return activeJSONFile;
+}
+
+QString SolarisRoom::getCurrentProjectName()
+{
+    // Extract project name from activeJSONFile path (without .json extension)
+    QFileInfo fileInfo(activeJSONFile);
+    QString baseName = fileInfo.baseName();
+    return baseName;
+}
+
+void SolarisRoom::setProjectData(const QJsonObject &data)
+{
+    project = SolarisProject::fromJson(data);
+}
+
+void SolarisRoom::setCommand(const QString &name, const QString &fileName, const QString &text)
+{
+    project.setCommand(name, fileName, text);
+}
+
+bool SolarisRoom::isSendToAll() const
+{
+    return sendToAllChannels;
+}
+
+void SolarisRoom::setSendToAll(bool value)
+{
+    sendToAllChannels = value;
+}
+
+void SolarisRoom::setRecorder(ShowRecorder *recorder)
+{
+    this->recorder = recorder;
+}
+
+void SolarisRoom::setReadOnly(bool value)
+{
+    readOnly = value;
+}
+
+int SolarisRoom::currentCounter() const
+{
+    return counter;
+}
+
+quint64 SolarisRoom::tickMessageCount() const
+{
+    return tickMessages;
+}
+
+quint64 SolarisRoom::tickFrameCount() const
+{
+    return tickFrames;
+}
+
+void SolarisRoom::sendToAll(QString message )
+{
+    if (recorder) {
+        recorder->record(ShowRecorder::Sent, roomId, nullptr, message);
+    }
+    foreach(QWebSocket *socket, m_clients) {
+        if (socket)
+        {
+            socket->sendTextMessage(message);
+        }
+    }
+}
+
+void SolarisRoom::sendToEditors(const QString &message)
+{
+    // Editing traffic stays off the performers, so audience load does not grow with editing activity
+    if (recorder) {
+        recorder->record(ShowRecorder::Sent, roomId, nullptr, message);
+    }
+    foreach(QWebSocket *socket, m_clients) {
+        if (socket && roles.value(socket) != PerformerRole)
+        {
+            socket->sendTextMessage(message);
+        }
+    }
+}
+
+int SolarisRoom::sendFrame(const QStringList &messages)
+{
+    // Everything of one tick goes out as a single frame per client:
+    // "batch\n<message>\n<message>..." - clients split it and handle the parts in order
+    if (messages.size() == 1) {
+        sendToAll(messages.first());
+        return 1;
+    }
+    for (const QString &message : messages) {
+        if (message.contains('\n')) {
+            // a cue text with a line break cannot be framed, fall back to separate messages
+            for (const QString &single : messages) {
+                sendToAll(single);
+            }
+            return messages.size();
+        }
+    }
+    sendToAll("batch\n" + messages.join('\n'));
+    return 1;
+}
+
+void SolarisRoom::sendTest()
+{
+    // format: 'play|channel|fileName|text' to players
+    qDebug() << "Sending test command";
+    sendToAll("play|0|test.mp3|Test. Test? Test!");
+}
+
+QString SolarisRoom::catchUpMessage(int channel)
+{
+    // Format: "catchUp|time|running|sendToAll|channel|fileName|offset|text"
+    // fileName, offset and text are empty when no cue for the channel is playing
+    bool running = timer.isActive();
+    // The current time is the last tick sent; after a seek it is the pending tick,
+    // whose cues are still to be played by that tick
+    bool ticked = running && tickedSinceSeek;
+    int currentTime = ticked ? lastTick : counter;
+
+    QString cueFileName, cueText, cueOffset;
+    if (running) {
+        // Walk back from the current time through the time index, latest matching cue wins
+        int first = project.lowerBound(currentTime - CATCHUP_WINDOW);
+        int end = project.lowerBound(ticked ? currentTime + 1 : currentTime);
+        for (int position = end - 1; position >= first; --position) {
+            const SolarisProject::Event &event = project.eventByTime(position);
+            QStringList channelsList = project.channels(event);
+            if (sendToAllChannels || channelsList.contains("0")
+                    || channelsList.contains(QString::number(channel))) {
+                findCommand(event, cueFileName, cueText);
+                cueOffset = QString::number(currentTime - event.time);
+                break;
+            }
+        }
+    }
+
+    return QString("catchUp|%1|%2|%3|%4|%5|%6|%7")
+        .arg(currentTime)
+        .arg(running ? "true" : "false")
+        .arg(sendToAllChannels ? "true" : "false")
+        .arg(channel)
+        .arg(cueFileName)
+        .arg(cueOffset)
+        .arg(cueText);
+}
+
+void SolarisRoom::counterChanged() // timer timeOut slot
+{
+
+    qDebug() << "Room" << roomId << "counter: " << counter;
+    lastTick = counter;
+    tickedSinceSeek = true;
+    if (recorder) {
+        recorder->record(ShowRecorder::Tick, roomId, nullptr, QString::number(counter));
+    }
+
+    // Send time BEFORE incrementing to avoid off-by-one error
+    QStringList frame;
+    frame << "time|" + QString::number(counter);
+
+    // Events at this second, from the project's time index
+    int end = project.lowerBound(counter + 1);
+    for (int position = project.lowerBound(counter); position < end; ++position) {
+        const SolarisProject::Event &event = project.eventByTime(position);
+        QStringList channelsList = project.channels(event);
+
+        // Find the command to get the text and filename
+        QString text;
+        QString fileName;
+        findCommand(event, fileName, text);
+
+        // Send play command to each channel
+        // If sendToAllChannels is enabled, send all events to channel 0 regardless of event's channel specification
+        if (sendToAllChannels) {
+            // Send to all channels (channel 0)
+            frame << QString("play|0|%1|%2").arg(fileName).arg(text);
+        } else {
+            // Use the channels specified in the event
+            for (const QString &channel : channelsList) {
+                if (channel == "0") {
+                    // Send to all channels
+                    frame << QString("play|0|%1|%2").arg(fileName).arg(text);
+                    break; // No need to send to other channels if we're sending to all
+                } else {
+                    // Send to specific channel
+                    frame << QString("play|%1|%2|%3").arg(channel).arg(fileName).arg(text);
+                }
+            }
+        }
+    }
+    tickMessages += frame.size();
+    tickFrames += sendFrame(frame);
+
+    counter++;
+    if (counter>END_AT) {
+        timer.stop();
+        qDebug()<< "Should be finished";
+        counter = START_FROM;
+    }
+
+}
+
+QStringList SolarisRoom::chaseMessages(int from, int time)
+{
+    // Format: "chase|channel|fileName|offset|text", oldest first so a performer ends up on its latest cue.
+    // Latest cue per channel that started in [from, time)
+    QStringList messages;
+    QSet<QString> seen;
+    int first = project.lowerBound(from);
+    for (int position = project.lowerBound(time) - 1; position >= first; --position) {
+        const SolarisProject::Event &event = project.eventByTime(position);
+        QStringList channelsList = sendToAllChannels ? QStringList("0") : project.channels(event);
+        if (channelsList.contains("0")) {
+            channelsList = QStringList("0");
+        }
+
+        QString text;
+        QString fileName;
+        findCommand(event, fileName, text);
+        for (const QString &channel : channelsList) {
+            if (seen.contains(channel)) {
+                continue;
+            }
+            seen.insert(channel);
+            messages.prepend(QString("chase|%1|%2|%3|%4").arg(channel).arg(fileName).arg(time - event.time).arg(text));
+        }
+        if (seen.contains("0")) {
+            break; // older cues are replaced by this one on every channel
+        }
+    }
+    return messages;
+}
+
+CachedProject SolarisRoom::stamp(const QString &fileName)
+{
+    QFileInfo info(fileName);
+    CachedProject entry;
+    if (info.exists()) {
+        entry.modified = info.lastModified();
+        entry.size = info.size();
+    }
+    return entry;
+}
+
+bool SolarisRoom::isCached(const QString &fileName) const
+{
+    auto it = projectCache->constFind(fileName);
+    if (it == projectCache->constEnd()) {
+        return false;
+    }
+    if (readOnly) {
+        return true; // replay keeps saved projects in memory only
+    }
+    // A file edited outside the server is parsed again
+    CachedProject current = stamp(fileName);
+    return current.size == it->size && current.modified == it->modified;
+}
+
+void SolarisRoom::findCommand(const SolarisProject::Event &event, QString &fileName, QString &text)
+{
+    if (event.command != -1) {
+        const SolarisProject::Command &command = project.commands().at(event.command);
+        text = project.string(command.text);
+        fileName = project.string(command.fileName);
+    } else {
+        // Defaults when the command is not defined in the project
+        text = "";
+        fileName = project.string(event.name) + ".mp3";
+    }
+}
@@ -0,0 +1,118 @@
+#ifndef SOLARISROOM_H
+#define SOLARISROOM_H
+
+#include <QtCore/QObject>
+#include <QtCore/QList>
+#include <QTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QDateTime>
+#include "solarisproject.h"
+
+QT_FORWARD_DECLARE_CLASS(QWebSocket)
+class ShowRecorder;
+
+#define START_FROM -4
+#define END_AT 1200
+#define CATCHUP_WINDOW 15 // seconds a started cue is still considered playing on reconnect
+#define MIN_SPEED 0.25
+#define MAX_SPEED 8.0
+
+// Compiled project shared by the rooms. An entry is only used while the file on disk
+// still has the size and modification time it was cached with.
+struct CachedProject
+{
+    SolarisProject project;
+    QDateTime modified;
+    qint64 size = -1;
+};
+typedef QHash<QString, CachedProject> ProjectCache; // keyed by project file path
+
+enum ClientRole {
+    UnknownRole,   // client did not declare a role, gets all room traffic as before
+    EditorRole,
+    PerformerRole  // transport and cue traffic only
+};
+
+// One performance: its own project, clock and set of clients.
+// Rooms share the server's connections and the project cache (fileName -> compiled project).
+class SolarisRoom : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SolarisRoom(const QString &id, ProjectCache *projectCache, QObject *parent = nullptr);
+
+    QString id() const;
+
+    void addClient(QWebSocket *socket, ClientRole role = UnknownRole);
+    void setRole(QWebSocket *socket, ClientRole role);
+    void removeClient(QWebSocket *socket);
+    QList<QWebSocket *> clients() const;
+
+    void start();
+    void start(int time);
+    void stop();
+    int seek(int time, bool chase = false); // returns the number of cues skipped by a forward seek
+    bool isRunning() const;
+    double speed() const;
+    double setSpeed(double value); // returns the speed actually set
+
+    void loadSolarisJSON(const QString &fileName);
+    void loadSolarisJSONAsync(const QString &fileName); // emits projectLoaded when swapped in
+    void refreshProject(const QString &fileName); // takes a version another room saved, keeps a load in progress
+    void saveSolarisJSON();
+    void saveSolarisJSON(const QString &fileName);
+    QString activeFile() const;
+    QString getCurrentProjectName();
+
+    void setProjectData(const QJsonObject &data);
+    void setCommand(const QString &name, const QString &fileName, const QString &text);
+    bool isSendToAll() const;
+    void setSendToAll(bool value);
+
+    void sendToAll(QString message);
+    void sendToEditors(const QString &message); // everyone but performers
+    int sendFrame(const QStringList &messages); // returns the number of messages sent to each client
+    void sendTest();
+    QString catchUpMessage(int channel);
+
+    void setRecorder(ShowRecorder *recorder);
+    void setReadOnly(bool value);
+    int currentCounter() const;
+    quint64 tickMessageCount() const;
+    quint64 tickFrameCount() const;
+
+Q_SIGNALS:
+    void projectSaved(const QString &fileName);
+    void projectLoaded(const QString &fileName, bool ok, qint64 elapsedMs);
+
+public Q_SLOTS:
+    void counterChanged(); // one tick; also called directly when replaying a show log
+
+private:
+    QString roomId;
+    ProjectCache *projectCache;
+    QList<QWebSocket *> m_clients;
+    QHash<QWebSocket *, ClientRole> roles;
+
+    QTimer timer;
+    int counter; // next tick to send
+    int lastTick; // last tick sent
+    bool tickedSinceSeek; // false after start/seek/stop until the next tick, counter is then the current time
+    double m_speed; // show seconds per real second, the timer fires once per show second
+    QString activeJSONFile;
+    SolarisProject project;
+    bool sendToAllChannels;
+    ShowRecorder *recorder;
+    bool readOnly; // replay: keep project changes in memory only
+    quint64 loadGeneration; // only the latest background load is swapped in
+    quint64 tickMessages; // messages produced by ticks, before batching
+    quint64 tickFrames; // WebSocket frames per client sent by ticks, after batching
+
+    void findCommand(const SolarisProject::Event &event, QString &fileName, QString &text);
+    static CachedProject stamp(const QString &fileName);
+    bool isCached(const QString &fileName) const;
+    QStringList chaseMessages(int from, int time);
+};
+
+#endif //SOLARISROOM_H
@@ -5,13 +5,17 @@
 #include "QtWebSockets/QWebSocket"
 #include <QtCore/QDebug>
 #include <QtCore/QFile>
-#include <QtCore/QProcess>
 #include <QtCore/QDir>
 #include <QtCore/QTextStream>
 #include <QtCore/QStringList>
 #include <QtCore/QJsonDocument>
 #include <QtCore/QJsonObject>
 #include <QtCore/QJsonArray>
+#include <QtCore/QUuid>
+#include <QtCore/QMap>
+#include <QtCore/QSet>
+#include <QtCore/QTimer>
+#include "projectcloner.h"
 #include <QtNetwork/QSslCertificate>
 #include <QtNetwork/QSslKey>
 #include <QCoreApplication>
@@ -23,9 +27,16 @@ SolarisServer::SolarisServer(quint16 port, QObject *parent) :
     QObject(parent),
     m_pWebSocketServer(nullptr),
     audioDir(QString()),
-    counter(START_FROM),
-    sendToAllChannels(false)
+    tts(nullptr),
+    recorder(nullptr),
+    offline(port == 0)
 {
+    if (offline) {
+        // No WebSocket server; used to replay show logs
+        initProjectPaths();
+        return;
+    }
+
     m_pWebSocketServer = new QWebSocketServer(QStringLiteral("SSL Echo Server"),
                                               QWebSocketServer::SecureMode,
                                               this);
@@ -48,42 +59,43 @@ SolarisServer::SolarisServer(quint16 port, QObject *parent) :
         connect(m_pWebSocketServer, &QWebSocketServer::sslErrors,
                 this, &SolarisServer::onSslErrors);
 
-        float m_speed = 1; // be ready set the speed, if needed
-        timer.setInterval(1000/m_speed);
-        connect(&timer, SIGNAL(timeout()), this, SLOT(counterChanged()) );
-
-        // Get the audio directory path (assuming it's ../audio relative to the executable)
-        audioDir = QCoreApplication::applicationDirPath() + "/../../../audio";
-        QDir dir(audioDir);
-        if (!dir.exists()) {
-            // Try alternative path
-            audioDir = QCoreApplication::applicationDirPath() + "/../../audio";
-            dir.setPath(audioDir);
-            if (!dir.exists()) {
-                qWarning() << "Audio directory not found:" << audioDir;
-                return;
-            }
-        }
-        audioDir = dir.absolutePath();
-        QDir audioDirObj(audioDir);
-        audioDirObj.cdUp();  // Go to parent directory
-        eventsFile = audioDirObj.absolutePath() + "/events.txt";
-        solarisJSONFile = audioDirObj.absolutePath() + "/solaris.json";
-        activeJSONFile = solarisJSONFile;  // Start with default file
-
-        loadEntries();
-        loadSolarisJSON();
-
+        initProjectPaths();
     }
 }
 
 
 SolarisServer::~SolarisServer()
 {
-    m_pWebSocketServer->close();
+    if (m_pWebSocketServer) {
+        m_pWebSocketServer->close();
+    }
     qDeleteAll(m_clients.begin(), m_clients.end());
 }
 
+void SolarisServer::initProjectPaths()
+{
+    // Get the audio directory path (assuming it's ../audio relative to the executable)
+    audioDir = QCoreApplication::applicationDirPath() + "/../../../audio";
+    QDir dir(audioDir);
+    if (!dir.exists()) {
+        // Try alternative path
+        audioDir = QCoreApplication::applicationDirPath() + "/../../audio";
+        dir.setPath(audioDir);
+        if (!dir.exists()) {
+            qWarning() << "Audio directory not found:" << audioDir;
+            return;
+        }
+    }
+    audioDir = dir.absolutePath();
+    QDir audioDirObj(audioDir);
+    audioDirObj.cdUp();  // Go to parent directory
+    eventsFile = audioDirObj.absolutePath() + "/events.txt";
+    solarisJSONFile = audioDirObj.absolutePath() + "/solaris.json";
+
+    loadEntries();
+    room(DEFAULT_ROOM);  // default room starts with the default file
+}
+
 bool SolarisServer::prepareSsl(const QString &certPath, const QString &keyPath) {
     QFile certFile(certPath);
     if (!certFile.open(QIODevice::ReadOnly)) {
@@ -147,61 +159,105 @@ void SolarisServer::onNewConnection()
     connect(pSocket, &QWebSocket::disconnected, this, &SolarisServer::socketDisconnected);
 
     m_clients << pSocket;
-    
-    // Send current project name to new client
-    QString projectName = getCurrentProjectName();
-    pSocket->sendTextMessage("currentProject|" + projectName);
+
+    // New clients get no room traffic until they join or resume, so a performer of another room
+    // never plays a cue of the default room. Clients that do neither end up in the default room.
+    if (recorder) {
+        recorder->record(ShowRecorder::Connected, DEFAULT_ROOM, pSocket, pSocket->peerAddress().toString());
+    }
+    QPointer<QWebSocket> socket(pSocket);
+    QTimer::singleShot(JOIN_TIMEOUT, this, [this, socket]() {
+        if (socket && !clientRooms.contains(socket)) {
+            joinRoom(socket, DEFAULT_ROOM);
+        }
+    });
+
+    // Issue a session token; a returning client sends it back with "resume" to catch up
+    pruneSessions();
+    pruneRooms(); // e.g. a room whose show ended after its last client left
+    createSession(pSocket);
 }
 
 void SolarisServer::processTextMessage(QString message)
 {
-    //QWebSocket *pClient = qobject_cast<QWebSocket *>(sender());
+    QWebSocket *pClient = qobject_cast<QWebSocket *>(sender());
+    // Any command other than the connect handshake puts a client without a room into the default room
+    if (pClient && !clientRooms.contains(pClient)) {
+        QString command = message.section('|', 0, 0).trimmed();
+        if (command != "join" && command != "resume" && command != "role" && command != "channel") {
+            joinRoom(pClient, DEFAULT_ROOM);
+        }
+    }
+    // All transport and project commands act on the sender's room
+    SolarisRoom *room = roomForClient(pClient);
+    if (recorder) {
+        recorder->record(ShowRecorder::Received, room->id(), pClient, message);
+    }
+    handleMessage(pClient, room, message);
+}
+
+void SolarisServer::handleMessage(QWebSocket *pClient, SolarisRoom *room, const QString &message)
+{
     qDebug()  << "Message received: " << message;
     
     QStringList messageParts = message.split("|");
     QString command = messageParts.count()>0 ? messageParts[0].trimmed(): "";
 
+    // Replay only drives the show; commands that generate audio or create files are skipped
+    if (offline && (command == "generate" || command == "generateCommand"
+                    || command == "newProject" || command == "saveAs")) {
+        qDebug() << "Offline, skipping" << command;
+        return;
+    }
+    if (!tts && (command == "generate" || command == "generateCommand")) {
+        qWarning() << "No TTS backend, skipping" << command;
+        return;
+    }
 
     if (command=="start") {
-        if (messageParts.count()>=2) {
-            bool ok;
-            int time = messageParts[1].toInt(&ok);
-            if (ok) {
-                counter = time;
-                qDebug()<< "Set time to: " << time;
-            }
+        bool ok = false;
+        int time = messageParts.count()>=2 ? messageParts[1].toInt(&ok) : 0;
+        if (ok) {
+            room->start(time);
+        } else {
+            room->start();
         }
-
-        timer.start();
     }
     if (command=="stop") {
-        timer.stop();
-        counter = START_FROM;
-        // Send stop command to all clients to clear their displays
-        sendToAll("stop");
+        room->stop();
     }
     if (command=="test") {
-        sendTest();
+        room->sendTest();
     }
     if (command=="seek" && messageParts.count()>=2) {
+        // seek|time or seek|time|chase
         bool ok;
         int time = messageParts[1].toInt(&ok);
         if (ok) {
-            counter = time;
-            qDebug()<< "Set time to: " << time;
+            // Format: "seeked | time | cues skipped" to the editor that asked
+            int skipped = room->seek(time, messageParts.count()>=3 && messageParts[2].trimmed() == "chase");
+            sendToClient(pClient, QString("seeked|%1|%2").arg(time).arg(skipped));
         }
     }
+    if (command=="speed") {
+        bool ok = false;
+        double speed = messageParts.count()>=2 ? messageParts[1].toDouble(&ok) : 0;
+        if (ok) {
+            room->sendToEditors(QString("speed|%1").arg(room->setSpeed(speed)));
+        }
+        return; // not echoed below: editors get the speed actually set, not the requested one
+    }
     
     if (command=="setSendToAll" && messageParts.count()>=2) {
         QString value = messageParts[1].trimmed();
-        sendToAllChannels = (value == "true");
-        qDebug() << "sendToAllChannels set to:" << sendToAllChannels;
+        room->setSendToAll(value == "true");
+        qDebug() << "sendToAllChannels set to:" << room->isSendToAll() << "in room" << room->id();
         
         // Save the updated state to JSON
-        saveSolarisJSON();
+        room->saveSolarisJSON();
         
-        // Broadcast the new state to all clients
-        sendToAll(QString("sendToAll|%1").arg(sendToAllChannels ? "true" : "false"));
+        // Broadcast the new state to the editors
+        room->sendToEditors(QString("sendToAll|%1").arg(room->isSendToAll() ? "true" : "false"));
     }
 
     // Check if the message is in the format "generate | text | filename | channel | time"
@@ -222,66 +278,12 @@ void SolarisServer::processTextMessage(QString message)
                      << "channel:" << channel << "time:" << time;
             
             
-            // Path to the generator script
-            QString generatorScript = audioDir + "/generator.py";
-            
-            // Path to the API key script
-            QString apiKeyScript = audioDir + "/elevenlabs-api-key.sh";
-            
-            // Create the command to source the API key and run the generator
-            // We need to properly escape arguments for bash
-            // Single quotes prevent any interpretation by bash, but we need to escape single quotes in the text
-            auto bashEscape = [](const QString &str) -> QString {
-                QString escaped = str;
-                escaped.replace("'", "'\\''");  // Replace ' with '\''
-                return "'" + escaped + "'";
-            };
-            
-            QString bashCommand = QString("source %1 && python3 %2 %3 %4 %5")
-                .arg(apiKeyScript)
-                .arg(generatorScript)
-                .arg(bashEscape(text))
-                .arg(bashEscape(channel))
-                .arg(bashEscape(filename));
-            
-            qDebug() << "Executing bash command:" << bashCommand;
-            
-            // Execute the command
-            QProcess process;
-            QStringList arguments;
-            arguments << "-c" << bashCommand;
-            process.start("bash", arguments);
-            
-            // Wait for the process to finish (with timeout)
-            if (process.waitForFinished(30000)) { // 30 second timeout
-                int exitCode = process.exitCode();
-                QString output = process.readAllStandardOutput();
-                QString errors = process.readAllStandardError();
-                
-                qDebug() << "Process output:" << output;
-                if (!errors.isEmpty()) {
-                    qDebug() << "Process errors:" << errors;
-                }
-                
-                if (exitCode == 0) {
-
-                    // Create the new entry
-                    QString newEntry = QString("%1|%2|%3.mp3|%4").arg(time).arg(channel).arg(filename).arg(text);
-
-                    // Check if the exact same entry already exists
-                    if (!entries.contains(newEntry)) {
-                        // Add the new entry
-                        entries.append(newEntry);
-                        sortAndSaveEntries();
-                    } else {
-                        qDebug() << "Entry already exists in events.txt, skipping duplicate";
-                    }
-                } else {
-                    qWarning() << "Generator script failed with exit code:" << exitCode;
-                }
-            } else {
-                qWarning() << "Generator script timed out or failed to start";
-            }
+            // The entry is added to events.txt once the audio exists
+            PendingGeneration generation;
+            generation.requester = pClient;
+            generation.entry = QString("%1|%2|%3.mp3|%4").arg(time).arg(channel).arg(filename).arg(text);
+            generation.name = filename;
+            pendingGenerations.insert(tts->generate(text, channel, filename), generation);
         } else {
             qWarning() << "Invalid generate message format. Expected 5 messageParts, got:" << messageParts.size();
         }
@@ -298,87 +300,18 @@ void SolarisServer::processTextMessage(QString message)
             
             qDebug() << "Processing command generation - text:" << text << "commandName:" << commandName;
             
-            // Path to the generator script
-            QString generatorScript = audioDir + "/generator.py";
-            
-            // Path to the API key script
-            QString apiKeyScript = audioDir + "/elevenlabs-api-key.sh";
-            
-            // Create the command to source the API key and run the generator
-            auto bashEscape = [](const QString &str) -> QString {
-                QString escaped = str;
-                escaped.replace("'", "'\\''");  // Replace ' with '\''
-                return "'" + escaped + "'";
-            };
-            
             // Get current project name and use it for the directory structure
-            QString projectName = getCurrentProjectName();
+            QString projectName = room->getCurrentProjectName();
             QString audioSubdir = QString("audiofiles/%1").arg(projectName);
             
-            QString bashCommand = QString("source %1 && python3 %2 %3 %4 %5")
-                .arg(apiKeyScript)
-                .arg(generatorScript)
-                .arg(bashEscape(text))
-                .arg(bashEscape(audioSubdir))
-                .arg(bashEscape(commandName));
-            
-            qDebug() << "Executing bash command:" << bashCommand;
-            
-            // Execute the command
-            QProcess process;
-            QStringList arguments;
-            arguments << "-c" << bashCommand;
-            process.start("bash", arguments);
-            
-            // Wait for the process to finish (with timeout)
-            if (process.waitForFinished(30000)) { // 30 second timeout
-                int exitCode = process.exitCode();
-                QString output = process.readAllStandardOutput();
-                QString errors = process.readAllStandardError();
-                
-                qDebug() << "Process output:" << output;
-                if (!errors.isEmpty()) {
-                    qDebug() << "Process errors:" << errors;
-                }
-                
-                if (exitCode == 0) {
-                    // Update solaris.json
-                    QJsonArray commands = solarisData["commands"].toArray();
-                    
-                    // Check if command already exists
-                    int existingIndex = -1;
-                    for (int i = 0; i < commands.size(); ++i) {
-                        QJsonObject cmd = commands[i].toObject();
-                        if (cmd["name"].toString() == commandName) {
-                            existingIndex = i;
-                            break;
-                        }
-                    }
-                    
-                    // Create command object
-                    QJsonObject commandObj;
-                    commandObj["name"] = commandName;
-                    commandObj["fileName"] = commandName + ".mp3";
-                    commandObj["text"] = text;
-                    
-                    if (existingIndex != -1) {
-                        // Replace existing command
-                        commands[existingIndex] = commandObj;
-                        qDebug() << "Replaced existing command:" << commandName;
-                    } else {
-                        // Add new command
-                        commands.append(commandObj);
-                        qDebug() << "Added new command:" << commandName;
-                    }
-                    
-                    solarisData["commands"] = commands;
-                    saveSolarisJSON();
-                } else {
-                    qWarning() << "Generator script failed with exit code:" << exitCode;
-                }
-            } else {
-                qWarning() << "Generator script timed out or failed to start";
-            }
+            // The command is stored when the audio exists, in the project it was requested for
+            PendingGeneration generation;
+            generation.requester = pClient;
+            generation.room = room;
+            generation.projectFile = room->activeFile();
+            generation.name = commandName;
+            generation.text = text;
+            pendingGenerations.insert(tts->generate(text, audioSubdir, commandName), generation);
         } else {
             qWarning() << "Invalid generateCommand message format. Expected 3 parts, got:" << messageParts.size();
         }
@@ -389,9 +322,9 @@ void SolarisServer::processTextMessage(QString message)
             QJsonDocument doc = QJsonDocument::fromJson(jsonString.toUtf8());
             
             if (!doc.isNull() && doc.isObject()) {
-                solarisData = doc.object();
-                saveSolarisJSON();
-                qDebug() << "Updated solaris.json from client";
+                room->setProjectData(doc.object());
+                room->saveSolarisJSON();
+                qDebug() << "Updated" << room->activeFile() << "from client";
             } else {
                 qWarning() << "Invalid JSON data received for updateJSON";
             }
@@ -407,9 +340,8 @@ void SolarisServer::processTextMessage(QString message)
             
             // Check if file already exists
             if (QFile::exists(newFileName)) {
-                QWebSocket *pClient = qobject_cast<QWebSocket *>(sender());
                 if (pClient) {
-                    pClient->sendTextMessage("projectError|File already exists");
+                    sendToClient(pClient, "projectError|File already exists");
                 }
                 qWarning() << "Project file already exists:" << newFileName;
             } else {
@@ -425,21 +357,20 @@ void SolarisServer::processTextMessage(QString message)
                     file.close();
                     
                     // Load the new project as active
-                    loadSolarisJSON(newFileName);
+                    room->loadSolarisJSON(newFileName);
+                    pruneProjectCache();
                     
-                    QWebSocket *pClient = qobject_cast<QWebSocket *>(sender());
                     if (pClient) {
-                        pClient->sendTextMessage("projectCreated|" + projectName);
+                        sendToClient(pClient, "projectCreated|" + projectName);
                     }
                     qDebug() << "Created and loaded new project:" << newFileName;
                     
                     // Notify all clients of the current project and that data has been updated
-                    sendToAll("currentProject|" + projectName);
-                    sendToAll("dataUpdated");
+                    room->sendToAll("currentProject|" + projectName);
+                    room->sendToEditors("dataUpdated");
                 } else {
-                    QWebSocket *pClient = qobject_cast<QWebSocket *>(sender());
                     if (pClient) {
-                        pClient->sendTextMessage("projectError|Failed to create file");
+                        sendToClient(pClient, "projectError|Failed to create file");
                     }
                     qWarning() << "Failed to create project file:" << newFileName;
                 }
@@ -458,9 +389,8 @@ void SolarisServer::processTextMessage(QString message)
             response += "|" + fileName;
         }
         
-        QWebSocket *pClient = qobject_cast<QWebSocket *>(sender());
         if (pClient) {
-            pClient->sendTextMessage(response);
+            sendToClient(pClient, response);
         }
         qDebug() << "Sent project list:" << jsonFiles;
     } else if (command == "loadProject") {
@@ -471,22 +401,12 @@ void SolarisServer::processTextMessage(QString message)
             QString fullPath = projectDir.absolutePath() + "/" + fileName;
             
             if (QFile::exists(fullPath)) {
-                loadSolarisJSON(fullPath);
-                
-                QWebSocket *pClient = qobject_cast<QWebSocket *>(sender());
-                if (pClient) {
-                    pClient->sendTextMessage("projectLoaded|" + fileName);
-                }
-                qDebug() << "Loaded project:" << fullPath;
-                
-                // Notify all clients of the current project and that data has been updated
-                QString projectName = getCurrentProjectName();
-                sendToAll("currentProject|" + projectName);
-                sendToAll("dataUpdated");
+                // Parsed in the background, clients are notified in onProjectLoaded()
+                pendingLoads.insert(room, pClient);
+                room->loadSolarisJSONAsync(fullPath);
             } else {
-                QWebSocket *pClient = qobject_cast<QWebSocket *>(sender());
                 if (pClient) {
-                    pClient->sendTextMessage("projectError|File not found");
+                    sendToClient(pClient, "projectError|File not found");
                 }
                 qWarning() << "Project file not found:" << fullPath;
             }
@@ -500,63 +420,69 @@ void SolarisServer::processTextMessage(QString message)
             
             // Check if file already exists
             if (QFile::exists(fullPath)) {
-                QWebSocket *pClient = qobject_cast<QWebSocket *>(sender());
                 if (pClient) {
-                    pClient->sendTextMessage("projectError|File already exists");
+                    sendToClient(pClient, "projectError|File already exists");
                 }
                 qWarning() << "File already exists:" << fullPath;
             } else {
-                saveSolarisJSON(fullPath);
-                
-                // Copy audio files from current project to new project
-                QString currentProjectName = getCurrentProjectName();
-                QString sourceAudioPath = audioDir + "/audiofiles/" + currentProjectName;
-                QString destAudioPath = audioDir + "/audiofiles/" + newFileName;
-                
-                // Check if source audio directory exists and has mp3 files
-                QDir sourceDir(sourceAudioPath);
-                if (sourceDir.exists()) {
-                    QStringList mp3Files = sourceDir.entryList(QStringList() << "*.mp3", QDir::Files);
-                    
-                    if (!mp3Files.isEmpty()) {
-                        // Create destination directory
-                        QDir().mkpath(destAudioPath);
-                        
-                        // Copy each mp3 file individually
-                        int copiedCount = 0;
-                        for (const QString &fileName : mp3Files) {
-                            QString sourcePath = sourceAudioPath + "/" + fileName;
-                            QString destPath = destAudioPath + "/" + fileName;
-                            if (QFile::copy(sourcePath, destPath)) {
-                                copiedCount++;
-                            } else {
-                                qWarning() << "Failed to copy" << sourcePath << "to" << destPath;
-                            }
-                        }
-                        
-                        if (copiedCount > 0) {
-                            qDebug() << "Copied" << copiedCount << "audio file(s) from" << sourceAudioPath << "to" << destAudioPath;
-                        }
-                    }
-                }
+                room->saveSolarisJSON(fullPath);
                 
-                QWebSocket *pClient = qobject_cast<QWebSocket *>(sender());
                 if (pClient) {
-                    pClient->sendTextMessage("projectSaved|" + newFileName);
+                    sendToClient(pClient, "projectSaved|" + newFileName);
                 }
                 qDebug() << "Saved project as:" << fullPath;
+                
+                // Clone audio files from current project to new project in the background
+                QString currentProjectName = room->getCurrentProjectName();
+                QString sourceAudioPath = audioDir + "/audiofiles/" + currentProjectName;
+                QString destAudioPath = audioDir + "/audiofiles/" + newFileName;
+                if (QDir(sourceAudioPath).exists()) {
+                    cloneProjectAudio(pClient, newFileName, sourceAudioPath, destAudioPath);
+                }
+            }
+        }
+    } else if (command == "join") {
+        // Format: "join | roomId"
+        if (pClient && messageParts.size() >= 2) {
+            joinRoom(pClient, messageParts[1].trimmed());
+        }
+    } else if (command == "listRooms") {
+        QString response = "roomList";
+        for (const QString &roomId : rooms.keys()) {
+            response += "|" + roomId;
+        }
+        if (pClient) {
+            sendToClient(pClient, response);
+        }
+    } else if (command == "resume") {
+        // Format: "resume | token | channel"
+        if (messageParts.size() >= 2) {
+            int channel = messageParts.size() >= 3 ? messageParts[2].trimmed().toInt() : 0;
+            if (pClient) {
+                resumeSession(pClient, messageParts[1].trimmed(), channel);
             }
         }
+    } else if (command == "role") {
+        // Format: "role | editor" or "role | performer"
+        if (pClient && messageParts.size() >= 2) {
+            QString role = messageParts[1].trimmed();
+            ClientRole clientRole = role == "editor" ? EditorRole
+                                  : role == "performer" ? PerformerRole : UnknownRole;
+            clientRoles.insert(pClient, clientRole);
+            room->setRole(pClient, clientRole);
+            qDebug() << "Client role:" << role << "in room" << room->id();
+        }
+    } else if (command == "channel") {
+        // Format: "channel | number" - performer reports its channel for catch-up
+        if (pClient && messageParts.size() >= 2 && socketSessions.contains(pClient)) {
+            sessions[socketSessions.value(pClient)].channel = messageParts[1].trimmed().toInt();
+        }
     } else if (messageParts[0] == "sendCommand") { // send  command to all connected clients
 
     } else {
 
-        // Echo message to all clients (keep existing behavior)
-        for (QWebSocket * client : m_clients) {
-            if (client) {
-                client->sendTextMessage(message);
-            }
-        }
+        // Echo editor traffic (e.g. collaboration messages) to the editors in the room
+        room->sendToEditors(message);
     }
 
 }
@@ -572,32 +498,94 @@ void SolarisServer::processBinaryMessage(QByteArray message)
 
 
 
-void SolarisServer::sendTest()
+void SolarisServer::socketDisconnected()
+{
+    qDebug() << "Client disconnected";
+    QWebSocket *pClient = qobject_cast<QWebSocket *>(sender());
+    if (pClient)
+    {
+        m_clients.removeAll(pClient);
+        clientRoles.remove(pClient);
+        SolarisRoom *clientRoom = clientRooms.take(pClient);
+        if (clientRoom) {
+            clientRoom->removeClient(pClient);
+        }
+        if (recorder) {
+            recorder->record(ShowRecorder::Disconnected, clientRoom ? clientRoom->id() : QString(DEFAULT_ROOM), pClient);
+        }
+        pruneRooms();
+
+        // Keep the session around so the client can resume it
+        QString token = socketSessions.take(pClient);
+        if (sessions.contains(token)) {
+            ClientSession &session = sessions[token];
+            session.socket = nullptr;
+            session.disconnectedSince.start();
+        }
+
+        pClient->deleteLater();
+    }
+}
+
+QString SolarisServer::createSession(QWebSocket *socket)
 {
-    // format: 'play|channel|fileName|text' to players
-    qDebug() << "Sending test command";
-    sendToAll("play|0|test.mp3|Test. Test? Test!");
+    QString token = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    ClientSession session;
+    session.socket = socket;
+    sessions.insert(token, session);
+    socketSessions.insert(socket, token);
+    sendToClient(socket, "session|" + token);
+    return token;
 }
 
-void SolarisServer::sendToAll(QString message )
+void SolarisServer::resumeSession(QWebSocket *socket, const QString &token, int channel)
 {
-    foreach(QWebSocket *socket, m_clients) {
-        if (socket)
-        {
-            socket->sendTextMessage(message);
+    if (!sessions.contains(token)) {
+        // Unknown or expired token - the client keeps the fresh session issued on connect
+        qDebug() << "Unknown session token, not resuming:" << token;
+        QString freshToken = socketSessions.value(socket);
+        if (channel > 0 && sessions.contains(freshToken)) {
+            sessions[freshToken].channel = channel;
         }
+        // the client falls back to joining its room itself
+        sendToClient(socket, "resumeFailed|" + token);
+        return;
     }
-}
 
+    // Drop the session issued on connect and rebind the old one to this socket
+    QString freshToken = socketSessions.value(socket);
+    if (freshToken != token) {
+        sessions.remove(freshToken);
+    }
+    ClientSession &session = sessions[token];
+    if (session.socket && session.socket != socket) {
+        socketSessions.remove(session.socket);
+    }
+    session.socket = socket;
+    session.disconnectedSince.invalidate();
+    if (channel > 0) {
+        session.channel = channel;
+    }
+    socketSessions.insert(socket, token);
 
-void SolarisServer::socketDisconnected()
+    qDebug() << "Resumed session" << token << "channel:" << session.channel << "room:" << session.room;
+    sendToClient(socket, "session|" + token);
+    if (!clientRooms.contains(socket) || roomForClient(socket)->id() != session.room) {
+        joinRoom(socket, session.room);
+    }
+    sendToClient(socket, roomForClient(socket)->catchUpMessage(session.channel));
+}
+
+void SolarisServer::pruneSessions()
 {
-    qDebug() << "Client disconnected";
-    QWebSocket *pClient = qobject_cast<QWebSocket *>(sender());
-    if (pClient)
-    {
-        m_clients.removeAll(pClient);
-        pClient->deleteLater();
+    for (auto it = sessions.begin(); it != sessions.end(); ) {
+        const ClientSession &session = it.value();
+        if (!session.socket && session.disconnectedSince.isValid()
+                && session.disconnectedSince.hasExpired(SESSION_EXPIRY * 1000)) {
+            it = sessions.erase(it);
+        } else {
+            ++it;
+        }
     }
 }
 
@@ -647,151 +635,341 @@ void SolarisServer::sortAndSaveEntries()
     }
 }
 
-void SolarisServer::loadSolarisJSON()
+SolarisRoom *SolarisServer::room(const QString &roomId)
 {
-    loadSolarisJSON(activeJSONFile);
+    // Rooms are created on first use and dropped by pruneRooms() once nobody uses them
+    SolarisRoom *room = rooms.value(roomId);
+    if (!room) {
+        room = new SolarisRoom(roomId, &projectCache, this);
+        room->setRecorder(recorder);
+        room->setReadOnly(offline);
+        connect(room, &SolarisRoom::projectSaved, this, &SolarisServer::onProjectSaved);
+        connect(room, &SolarisRoom::projectLoaded, this, &SolarisServer::onProjectLoaded);
+        rooms.insert(roomId, room);
+        // A cached default project is shared at once; otherwise it is parsed in the background,
+        // so a new room does not stall the ticks of the others. A missing file starts out empty.
+        if (QFile::exists(solarisJSONFile)) {
+            room->loadSolarisJSONAsync(solarisJSONFile);
+        } else {
+            room->loadSolarisJSON(solarisJSONFile);
+        }
+        qDebug() << "Created room" << roomId;
+    }
+    return room;
 }
 
-void SolarisServer::loadSolarisJSON(const QString &fileName)
+void SolarisServer::pruneRooms()
 {
-    QFile file(fileName);
-    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        QByteArray data = file.readAll();
-        file.close();
-        
-        QJsonDocument doc = QJsonDocument::fromJson(data);
-        if (!doc.isNull() && doc.isObject()) {
-            solarisData = doc.object();
-            activeJSONFile = fileName;
-            
-            // Load sendToAll flag
-            sendToAllChannels = solarisData.value("sendToAll").toBool(false);
-            
-            qDebug() << "Successfully loaded" << fileName;
-            qDebug() << "sendToAllChannels:" << sendToAllChannels;
+    // Empty, stopped rooms other than the default one are dropped, e.g. one joined by a mistyped ?room=.
+    // Rooms still waiting for a requested load or a generated command are kept until a later pass.
+    if (offline) {
+        return; // replay reports on every room it created
+    }
+    QSet<SolarisRoom *> busy;
+    for (const PendingGeneration &generation : qAsConst(pendingGenerations)) {
+        busy.insert(generation.room);
+    }
+    for (auto it = rooms.begin(); it != rooms.end(); ) {
+        SolarisRoom *room = it.value();
+        if (it.key() != DEFAULT_ROOM && room->clients().isEmpty() && !room->isRunning()
+                && !pendingLoads.contains(room) && !busy.contains(room)) {
+            qDebug() << "Dropping empty room" << it.key();
+            it = rooms.erase(it);
+            room->deleteLater(); // may still be the room of the message being handled
         } else {
-            qWarning() << "Failed to parse" << fileName;
-            // Initialize with empty structure
-            solarisData = QJsonObject();
-            solarisData["commands"] = QJsonArray();
-            solarisData["events"] = QJsonArray();
-            solarisData["sendToAll"] = false;
-            sendToAllChannels = false;
+            ++it;
         }
-    } else {
-        qDebug() << fileName << "not found, creating new structure";
-        // Initialize with empty structure
-        solarisData = QJsonObject();
-        solarisData["commands"] = QJsonArray();
-        solarisData["events"] = QJsonArray();
-        solarisData["sendToAll"] = false;
-        sendToAllChannels = false;
     }
+    pruneProjectCache();
 }
 
-void SolarisServer::saveSolarisJSON()
+void SolarisServer::sendToClient(QWebSocket *socket, const QString &message)
 {
-    saveSolarisJSON(activeJSONFile);
+    // Replies to a single client go into the show log as well, with that client's id
+    if (!socket) {
+        return;
+    }
+    if (recorder) {
+        SolarisRoom *clientRoom = clientRooms.value(socket);
+        recorder->record(ShowRecorder::Sent, clientRoom ? clientRoom->id() : QString(DEFAULT_ROOM), socket, message);
+    }
+    socket->sendTextMessage(message);
 }
 
-void SolarisServer::saveSolarisJSON(const QString &fileName)
+SolarisRoom *SolarisServer::roomForClient(QWebSocket *socket)
 {
-    // Update sendToAll in the JSON object before saving
-    solarisData["sendToAll"] = sendToAllChannels;
-    
-    QFile file(fileName);
-    if (file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
-        QJsonDocument doc(solarisData);
-        file.write(doc.toJson(QJsonDocument::Indented));
-        file.close();
-        qDebug() << "Successfully saved" << fileName;
-        
-        // Notify all clients that data has been updated
-        sendToAll("dataUpdated");
-    } else {
-        qWarning() << "Failed to open for writing:" << fileName;
+    SolarisRoom *clientRoom = clientRooms.value(socket);
+    return clientRoom ? clientRoom : room(DEFAULT_ROOM);
+}
+
+void SolarisServer::joinRoom(QWebSocket *socket, const QString &roomId)
+{
+    QString id = roomId.isEmpty() ? QString(DEFAULT_ROOM) : roomId;
+
+    SolarisRoom *oldRoom = clientRooms.value(socket);
+    if (oldRoom) {
+        oldRoom->removeClient(socket);
     }
+    SolarisRoom *newRoom = room(id);
+    newRoom->addClient(socket, clientRoles.value(socket, UnknownRole));
+    clientRooms.insert(socket, newRoom);
+    pruneRooms(); // only now, so rejoining the same room keeps it
+
+    QString token = socketSessions.value(socket);
+    if (sessions.contains(token)) {
+        sessions[token].room = id;
+    }
+
+    qDebug() << "Client joined room" << id;
+    sendToClient(socket, "joined|" + id);
+    sendToClient(socket, "currentProject|" + newRoom->getCurrentProjectName());
+    sendToClient(socket, QString("sendToAll|%1").arg(newRoom->isSendToAll() ? "true" : "false"));
 }
 
-QString SolarisServer::getCurrentProjectName()
+void SolarisServer::onProjectSaved(const QString &fileName)
 {
-    // Extract project name from activeJSONFile path (without .json extension)
-    QFileInfo fileInfo(activeJSONFile);
-    QString baseName = fileInfo.baseName();
-    return baseName;
+    // Other rooms playing the same project pick up the saved version from the cache
+    SolarisRoom *savingRoom = qobject_cast<SolarisRoom *>(sender());
+    for (SolarisRoom *otherRoom : rooms) {
+        if (otherRoom != savingRoom && otherRoom->activeFile() == fileName) {
+            otherRoom->refreshProject(fileName);
+            otherRoom->sendToEditors("dataUpdated");
+        }
+    }
+    pruneProjectCache(); // e.g. the copy written by saveAs
 }
 
+void SolarisServer::pruneProjectCache()
+{
+    // Drop projects no room plays any more, large scores are not kept for good
+    QSet<QString> active;
+    for (SolarisRoom *room : qAsConst(rooms)) {
+        active.insert(room->activeFile());
+    }
+    for (auto it = projectCache.begin(); it != projectCache.end(); ) {
+        if (!active.contains(it.key())) {
+            qDebug() << "Dropping cached project" << it.key();
+            it = projectCache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
 
 
-void SolarisServer::counterChanged() // timer timeOut slot
+void SolarisServer::onProjectLoaded(const QString &fileName, bool ok, qint64 elapsedMs)
 {
+    SolarisRoom *loadedRoom = qobject_cast<SolarisRoom *>(sender());
+    QPointer<QWebSocket> requester = pendingLoads.take(loadedRoom);
+    QString shortName = QFileInfo(fileName).fileName();
+    pruneProjectCache();
+
+    if (!ok) {
+        if (requester) {
+            sendToClient(requester, "projectError|Failed to load " + shortName);
+        }
+        return;
+    }
 
-    qDebug() << "Counter: " << counter;
-    
-    // Send time BEFORE incrementing to avoid off-by-one error
-    sendToAll("time|" + QString::number(counter));
-    
-    // Use JSON events from solaris.json
-    QJsonArray events = solarisData["events"].toArray();
-    QJsonArray commands = solarisData["commands"].toArray();
-    
-    for (const QJsonValue &eventValue : events) {
-        QJsonObject event = eventValue.toObject();
-        int eventTime = event["time"].toInt();
-        
-        if (eventTime == counter) {
-            QString commandName = event["name"].toString();
-            
-            // Handle both "channels" array and old "channel" string format
-            QStringList channelsList;
-            if (event.contains("channels") && event["channels"].isArray()) {
-                QJsonArray channelsArray = event["channels"].toArray();
-                for (const QJsonValue &chValue : channelsArray) {
-                    channelsList.append(chValue.toString());
-                }
-            } else if (event.contains("channel")) {
-                channelsList.append(event["channel"].toString());
-            }
-            
-            // Find the command to get the text and filename
-            QString text = "";
-            QString fileName = commandName + ".mp3";
-            
-            for (const QJsonValue &cmdValue : commands) {
-                QJsonObject cmd = cmdValue.toObject();
-                if (cmd["name"].toString() == commandName) {
-                    text = cmd["text"].toString();
-                    fileName = cmd["fileName"].toString();
-                    break;
-                }
-            }
-            
-            // Send play command to each channel
-            // If sendToAllChannels is enabled, send all events to channel 0 regardless of event's channel specification
-            if (sendToAllChannels) {
-                // Send to all channels (channel 0)
-                sendToAll(QString("play|0|%1|%2").arg(fileName).arg(text));
-            } else {
-                // Use the channels specified in the event
-                for (const QString &channel : channelsList) {
-                    if (channel == "0") {
-                        // Send to all channels
-                        sendToAll(QString("play|0|%1|%2").arg(fileName).arg(text));
-                        break; // No need to send to other channels if we're sending to all
-                    } else {
-                        // Send to specific channel
-                        sendToAll(QString("play|%1|%2|%3").arg(channel).arg(fileName).arg(text));
-                    }
-                }
-            }
+    // Format: "projectLoaded | fileName | load time in ms"
+    if (requester) {
+        sendToClient(requester, QString("projectLoaded|%1|%2").arg(shortName).arg(elapsedMs));
+    }
+    qDebug() << "Loaded project:" << fileName << "in" << elapsedMs << "ms";
+
+    // Notify all clients of the current project and that data has been updated
+    QString projectName = loadedRoom->getCurrentProjectName();
+    loadedRoom->sendToAll("currentProject|" + projectName);
+    loadedRoom->sendToEditors("dataUpdated");
+}
+
+
+void SolarisServer::cloneProjectAudio(QWebSocket *pClient, const QString &projectName,
+                                      const QString &sourceAudioPath, const QString &destAudioPath)
+{
+    // Progress goes to the editor that asked for saveAs:
+    // "cloneProgress | project | done | total", then "cloneFinished | project | linked | copied | failed"
+    QPointer<QWebSocket> requester(pClient);
+    ProjectCloner *cloner = new ProjectCloner(sourceAudioPath, destAudioPath, this);
+    connect(cloner, &ProjectCloner::progress, this, [this, requester, projectName](int done, int total) {
+        if (requester) {
+            sendToClient(requester, QString("cloneProgress|%1|%2|%3").arg(projectName).arg(done).arg(total));
+        }
+    });
+    connect(cloner, &ProjectCloner::finished, this, [this, requester, projectName, cloner](int linked, int copied, int failed) {
+        if (requester) {
+            sendToClient(requester, QString("cloneFinished|%1|%2|%3|%4").arg(projectName).arg(linked).arg(copied).arg(failed));
+        }
+        cloner->deleteLater();
+    });
+    cloner->start();
+}
+
+bool SolarisServer::setTtsBackend(const QString &name)
+{
+    TtsBackend *backend = TtsBackend::create(name, audioDir, this);
+    if (!backend) {
+        return false;
+    }
+    delete tts;
+    tts = backend;
+    connect(tts, &TtsBackend::finished, this, &SolarisServer::onGenerationFinished);
+    qDebug() << "Using TTS backend" << tts->name();
+    return true;
+}
+
+int SolarisServer::benchmarkTts(int count)
+{
+    if (!tts) {
+        return 1;
+    }
+    return TtsBackend::benchmark(tts, count);
+}
+
+void SolarisServer::onGenerationFinished(quint64 id, bool ok, const QString &error)
+{
+    if (!pendingGenerations.contains(id)) {
+        return; // e.g. benchmark requests
+    }
+    PendingGeneration generation = pendingGenerations.take(id);
+
+    if (!ok) {
+        qWarning() << "Generation of" << generation.name << "failed:" << error;
+        if (generation.requester) {
+            sendToClient(generation.requester, QString("generateError|%1|%2").arg(generation.name).arg(error));
+        }
+        return;
+    }
+
+    if (!generation.room) {
+        // Check if the exact same entry already exists
+        if (!entries.contains(generation.entry)) {
+            // Add the new entry
+            entries.append(generation.entry);
+            sortAndSaveEntries();
+        } else {
+            qDebug() << "Entry already exists in events.txt, skipping duplicate";
+        }
+        sendToClient(generation.requester, "generated|" + generation.name);
+        return;
+    }
+
+    // The editor may have switched projects while the audio was generated
+    if (generation.room->activeFile() != generation.projectFile) {
+        qWarning() << "Project changed during generation, not storing command" << generation.name;
+        if (generation.requester) {
+            sendToClient(generation.requester, QString("generateError|%1|Project changed during generation").arg(generation.name));
         }
+        return;
+    }
+
+    // Add or replace the command in the project and save solaris.json
+    generation.room->setCommand(generation.name, generation.name + ".mp3", generation.text);
+    qDebug() << "Stored command:" << generation.name;
+    generation.room->saveSolarisJSON();
+    sendToClient(generation.requester, "generated|" + generation.name);
+}
+
+bool SolarisServer::startRecording(const QString &fileName)
+{
+    recorder = new ShowRecorder(this);
+    if (!recorder->open(fileName)) {
+        delete recorder;
+        recorder = nullptr;
+        return false;
+    }
+    for (SolarisRoom *room : rooms) {
+        room->setRecorder(recorder);
     }
+    return true;
+}
 
-    counter++;
-    if (counter>1200) {
-        timer.stop();
-        qDebug()<< "Should be finished";
-        counter = START_FROM;
+int SolarisServer::replay(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCritical() << "Cannot open show log:" << fileName;
+        return 1;
+    }
+    QDataStream in(&file);
+    if (!ShowRecorder::readHeader(in)) {
+        qCritical() << "Not a show log:" << fileName;
+        return 1;
     }
 
+    // Feed ticks and client messages back through the dispatch path as fast as possible
+    struct Timing {
+        quint64 count = 0;
+        qint64 totalNs = 0;
+        qint64 maxNs = 0;
+    };
+    QMap<quint8, Timing> timings;
+    int tickMismatches = 0;
+    qint64 firstNs = -1;
+    qint64 lastNs = 0;
+
+    QElapsedTimer wallClock;
+    QElapsedTimer step;
+    wallClock.start();
+
+    ShowRecord record;
+    while (ShowRecorder::readRecord(in, record)) {
+        if (firstNs < 0) {
+            firstNs = record.nsecs;
+        }
+        lastNs = record.nsecs;
+
+        SolarisRoom *replayRoom = room(record.room.isEmpty() ? QString(DEFAULT_ROOM) : record.room);
+        step.start();
+        if (record.type == ShowRecorder::Tick) {
+            // a different counter here means the replayed state diverged from the show
+            if (replayRoom->currentCounter() != record.payload.toInt()) {
+                tickMismatches++;
+            }
+            replayRoom->counterChanged();
+        } else if (record.type == ShowRecorder::Received) {
+            handleMessage(nullptr, replayRoom, record.payload);
+        }
+        // sent messages are produced by ticks and commands; connects carry no input
+        qint64 elapsed = step.nsecsElapsed();
+
+        Timing &timing = timings[record.type];
+        timing.count++;
+        timing.totalNs += elapsed;
+        timing.maxNs = qMax(timing.maxNs, elapsed);
+    }
+
+    qint64 wallNs = wallClock.nsecsElapsed();
+    qint64 showNs = firstNs < 0 ? 0 : lastNs - firstNs;
+    qInfo().noquote() << QString("Replayed %1: show %2 s in %3 ms (%4x real time)")
+                         .arg(fileName)
+                         .arg(showNs / 1e9, 0, 'f', 1)
+                         .arg(wallNs / 1e6, 0, 'f', 1)
+                         .arg(wallNs > 0 ? double(showNs) / wallNs : 0.0, 0, 'f', 0);
+    for (auto it = timings.constBegin(); it != timings.constEnd(); ++it) {
+        const Timing &timing = it.value();
+        qInfo().noquote() << QString("  %1: %2 records, avg %3 us, max %4 us")
+                             .arg(ShowRecorder::typeName(it.key()), -12)
+                             .arg(timing.count)
+                             .arg(timing.totalNs / 1e3 / qMax<quint64>(timing.count, 1), 0, 'f', 1)
+                             .arg(timing.maxNs / 1e3, 0, 'f', 1);
+    }
+    // Every frame is one send() on each client's socket and usually one TCP packet, so messages
+    // per tick are the writes without batching and frames per tick the writes with it
+    quint64 tickMessages = 0;
+    quint64 tickFrames = 0;
+    for (SolarisRoom *replayRoom : qAsConst(rooms)) {
+        tickMessages += replayRoom->tickMessageCount();
+        tickFrames += replayRoom->tickFrameCount();
+    }
+    quint64 ticks = timings.value(ShowRecorder::Tick).count;
+    if (ticks) {
+        qInfo().noquote() << QString("  per client per tick: %1 messages, %2 frames (writes)")
+                             .arg(double(tickMessages) / ticks, 0, 'f', 2)
+                             .arg(double(tickFrames) / ticks, 0, 'f', 2);
+    }
+    if (tickMismatches) {
+        qInfo() << "  tick counter mismatches:" << tickMismatches;
+    }
+    return 0;
 }
@@ -8,32 +8,71 @@
 #include <QtNetwork/QSslCertificate>
 #include <QtNetwork/QSslKey>
 #include <QSslConfiguration>
-#include <QTimer>
 #include <QJsonObject>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QPointer>
+#include "solarisroom.h"
+#include "showrecorder.h"
+#include "ttsbackend.h"
 
 QT_FORWARD_DECLARE_CLASS(QWebSocketServer)
 QT_FORWARD_DECLARE_CLASS(QWebSocket)
 
-#define START_FROM -4
+#define SESSION_EXPIRY 3600 // seconds a disconnected client may still resume its session
+#define DEFAULT_ROOM "main"
+#define JOIN_TIMEOUT 2000 // ms a new client may take to join or resume before it is put into the default room
+
+// Per-client state that survives reconnects, addressed by the token sent in "session|<token>"
+struct ClientSession
+{
+    QWebSocket *socket = nullptr;
+    int channel = 0; // 0 - not reported yet
+    QString room = DEFAULT_ROOM;
+    QElapsedTimer disconnectedSince;
+};
+
+// What to do when a TTS request finishes: add an events.txt entry (legacy "generate")
+// or store a command in the project it was requested for ("generateCommand")
+struct PendingGeneration
+{
+    QPointer<QWebSocket> requester;
+    SolarisRoom *room = nullptr; // nullptr - legacy entry
+    QString projectFile;
+    QString name;
+    QString text;
+    QString entry;
+};
 
 class SolarisServer : public QObject
 {
     Q_OBJECT
 public:
-    explicit SolarisServer(quint16 port, QObject *parent = nullptr);
+    explicit SolarisServer(quint16 port, QObject *parent = nullptr); // port 0 - offline, for replay
     ~SolarisServer() override;
 
+    bool startRecording(const QString &fileName);
+    int replay(const QString &fileName);
+    bool setTtsBackend(const QString &name);
+    int benchmarkTts(int count);
+
     void loadEntries();
     void sortAndSaveEntries();
-    
-    void loadSolarisJSON();
-    void saveSolarisJSON();
-    void loadSolarisJSON(const QString &fileName);
-    void saveSolarisJSON(const QString &fileName);
-    QString getCurrentProjectName();
 
-    void sendToAll(QString message);
-    void sendTest();
+    SolarisRoom *room(const QString &roomId);
+    SolarisRoom *roomForClient(QWebSocket *socket);
+    void joinRoom(QWebSocket *socket, const QString &roomId);
+    void sendToClient(QWebSocket *socket, const QString &message);
+    void pruneProjectCache();
+    void pruneRooms();
+
+    QString createSession(QWebSocket *socket);
+    void resumeSession(QWebSocket *socket, const QString &token, int channel);
+    void pruneSessions();
+
+    void handleMessage(QWebSocket *pClient, SolarisRoom *room, const QString &message);
+    void cloneProjectAudio(QWebSocket *pClient, const QString &projectName,
+                           const QString &sourceAudioPath, const QString &destAudioPath);
 
 
 
@@ -44,24 +83,36 @@ private Q_SLOTS:
     void socketDisconnected();
     void onSslErrors(const QList<QSslError> &errors);
 
-    void counterChanged();
+    void onProjectSaved(const QString &fileName);
+    void onProjectLoaded(const QString &fileName, bool ok, qint64 elapsedMs);
+    void onGenerationFinished(quint64 id, bool ok, const QString &error);
 
 private:
     QWebSocketServer *m_pWebSocketServer;
     QList<QWebSocket *> m_clients;
     bool prepareSsl(const QString &certPath, const QString &keyPath);
     QSslConfiguration m_sslConfig;
+    void initProjectPaths();
 
-    QTimer timer;
-    int counter;
     QString audioDir;
     QStringList entries;
     QString eventsFile;
     QString solarisJSONFile;
-    QString activeJSONFile;
-    QJsonObject solarisData;
-    bool sendToAllChannels;
 
+    QHash<QString, SolarisRoom *> rooms;
+    QHash<QWebSocket *, SolarisRoom *> clientRooms;
+    QHash<QWebSocket *, ClientRole> clientRoles; // kept across room changes
+    ProjectCache projectCache; // shared by all rooms, only files some room plays are kept
+    QHash<SolarisRoom *, QPointer<QWebSocket>> pendingLoads; // who asked for the load in progress
+
+    QHash<QString, ClientSession> sessions;
+    QHash<QWebSocket *, QString> socketSessions;
+
+    TtsBackend *tts;
+    QHash<quint64, PendingGeneration> pendingGenerations; // by TTS request id
+
+    ShowRecorder *recorder;
+    bool offline;
 };
 
 #endif //SOLARISSERVER_H
@@ -1,4 +1,4 @@
-QT = websockets
+QT = websockets concurrent
 
 TARGET = solarisserver
 CONFIG   += console
@@ -8,10 +8,24 @@ TEMPLATE = app
 
 SOURCES += \
     main.cpp \
-    solarisserver.cpp
+    solarisserver.cpp \
+    solarisroom.cpp \
+    showrecorder.cpp \
+    solarisproject.cpp \
+    projectcloner.cpp \
+    ttsbackend.cpp \
+    ttsworkerbackend.cpp \
+    mockttsbackend.cpp
 
 HEADERS += \
-    solarisserver.h
+    solarisserver.h \
+    solarisroom.h \
+    showrecorder.h \
+    solarisproject.h \
+    projectcloner.h \
+    ttsbackend.h \
+    ttsworkerbackend.h \
+    mockttsbackend.h
 
 EXAMPLE_FILES += sslechoclient.html
 
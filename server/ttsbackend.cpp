@@ -0,0 +1,65 @@
+#include "ttsbackend.h"
+#include "ttsworkerbackend.h"
+#include "mockttsbackend.h"
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QEventLoop>
+#include <QtCore/QElapsedTimer>
+
+TtsBackend::TtsBackend(const QString &audioDir, QObject *parent) :
+    QObject(parent),
+    audioDir(audioDir),
+    nextId(1)
+{
+}
+
+TtsBackend *TtsBackend::create(const QString &name, const QString &audioDir, QObject *parent)
+{
+    if (name == "worker") {
+        return new TtsWorkerBackend(audioDir, parent);
+    } else if (name == "mock") {
+        return new MockTtsBackend(audioDir, parent);
+    }
+    qWarning() << "Unknown TTS backend:" << name;
+    return nullptr;
+}
+
+QString TtsBackend::outputPath(const QString &subdir, const QString &fileName) const
+{
+    return QDir(audioDir).filePath(subdir + "/" + fileName + ".mp3");
+}
+
+int TtsBackend::benchmark(TtsBackend *backend, int count)
+{
+    // Queue all requests at once and wait for the last result: measures sustained throughput
+    int done = 0;
+    int failed = 0;
+    QEventLoop loop;
+    QObject::connect(backend, &TtsBackend::finished, &loop, [&](quint64, bool ok, const QString &error) {
+        if (!ok) {
+            failed++;
+            qWarning() << "Generation failed:" << error;
+        }
+        if (++done == count) {
+            loop.quit();
+        }
+    });
+
+    QElapsedTimer clock;
+    clock.start();
+    for (int i = 0; i < count; ++i) {
+        backend->generate(QString("Benchmark cue number %1.").arg(i), "audiofiles/benchmark", QString("cue%1").arg(i));
+    }
+    if (count > 0) {
+        loop.exec();
+    }
+    qint64 elapsed = clock.elapsed();
+
+    qInfo().noquote() << QString("%1 backend: %2 cues in %3 ms, %4 cues/s, %5 failed")
+                         .arg(backend->name())
+                         .arg(count)
+                         .arg(elapsed)
+                         .arg(elapsed > 0 ? count * 1000.0 / elapsed : 0.0, 0, 'f', 1)
+                         .arg(failed);
+    return failed ? 1 : 0;
+}
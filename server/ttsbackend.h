@@ -0,0 +1,33 @@
+#ifndef TTSBACKEND_H
+#define TTSBACKEND_H
+
+#include <QtCore/QObject>
+#include <QtCore/QString>
+
+// Text-to-speech provider. generate() returns a request id right away and finished() reports
+// the result later on the event loop thread. The audio is written to
+// <audioDir>/<subdir>/<fileName>.mp3 and renamed into place, so hard-linked clones keep their files.
+class TtsBackend : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TtsBackend(const QString &audioDir, QObject *parent = nullptr);
+
+    // "worker" - persistent generator.py process, "mock" - local synthetic audio; nullptr if unknown
+    static TtsBackend *create(const QString &name, const QString &audioDir, QObject *parent = nullptr);
+    static int benchmark(TtsBackend *backend, int count);
+
+    virtual QString name() const = 0;
+    virtual quint64 generate(const QString &text, const QString &subdir, const QString &fileName) = 0;
+
+    QString outputPath(const QString &subdir, const QString &fileName) const;
+
+Q_SIGNALS:
+    void finished(quint64 id, bool ok, const QString &error);
+
+protected:
+    QString audioDir;
+    quint64 nextId;
+};
+
+#endif //TTSBACKEND_H
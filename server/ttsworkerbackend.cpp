@@ -0,0 +1,140 @@
+#include "ttsworkerbackend.h"
+#include <QtCore/QDebug>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+
+TtsWorkerBackend::TtsWorkerBackend(const QString &audioDir, QObject *parent) :
+    TtsBackend(audioDir, parent)
+{
+    process.setWorkingDirectory(audioDir);
+    connect(&process, &QProcess::readyReadStandardOutput, this, &TtsWorkerBackend::onReadyRead);
+    connect(&process, &QProcess::readyReadStandardError, this, &TtsWorkerBackend::onReadyReadError);
+    connect(&process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, &TtsWorkerBackend::onFinished);
+    connect(&process, &QProcess::errorOccurred, this, &TtsWorkerBackend::onErrorOccurred);
+
+    watchdog.setSingleShot(true);
+    watchdog.setInterval(TTS_WORKER_TIMEOUT);
+    connect(&watchdog, &QTimer::timeout, this, &TtsWorkerBackend::onTimeout);
+}
+
+TtsWorkerBackend::~TtsWorkerBackend()
+{
+    if (process.state() != QProcess::NotRunning) {
+        process.closeWriteChannel(); // the worker exits at end of input
+        if (!process.waitForFinished(1000)) {
+            process.kill();
+            process.waitForFinished(1000);
+        }
+    }
+}
+
+QString TtsWorkerBackend::name() const
+{
+    return "worker";
+}
+
+quint64 TtsWorkerBackend::generate(const QString &text, const QString &subdir, const QString &fileName)
+{
+    ensureStarted();
+
+    quint64 id = nextId++;
+    QJsonObject request;
+    request["id"] = qint64(id);
+    request["text"] = text;
+    request["dir"] = subdir;
+    request["name"] = fileName;
+    // QProcess buffers the line until the worker has started
+    process.write(QJsonDocument(request).toJson(QJsonDocument::Compact) + "\n");
+
+    pending << id;
+    if (!watchdog.isActive()) {
+        watchdog.start();
+    }
+    return id;
+}
+
+void TtsWorkerBackend::ensureStarted()
+{
+    if (process.state() != QProcess::NotRunning) {
+        return;
+    }
+
+    // Same environment as the one-shot calls: the API key comes from elevenlabs-api-key.sh
+    auto bashEscape = [](const QString &str) -> QString {
+        QString escaped = str;
+        escaped.replace("'", "'\\''");  // Replace ' with '\''
+        return "'" + escaped + "'";
+    };
+    QString bashCommand = QString("source %1 && exec python3 -u %2 --serve")
+        .arg(bashEscape(audioDir + "/elevenlabs-api-key.sh"))
+        .arg(bashEscape(audioDir + "/generator.py"));
+
+    qDebug() << "Starting TTS worker:" << bashCommand;
+    process.start("bash", QStringList() << "-c" << bashCommand);
+}
+
+void TtsWorkerBackend::onReadyRead()
+{
+    while (process.canReadLine()) {
+        QByteArray line = process.readLine().trimmed();
+        QJsonObject response = QJsonDocument::fromJson(line).object();
+        if (!response.contains("id")) {
+            qDebug() << "TTS worker:" << line;
+            continue;
+        }
+
+        quint64 id = quint64(response.value("id").toDouble());
+        pending.removeOne(id);
+        if (pending.isEmpty()) {
+            watchdog.stop();
+        } else {
+            watchdog.start();
+        }
+
+        bool ok = response.value("ok").toBool();
+        QString error = response.value("error").toString();
+        if (!ok) {
+            qWarning() << "TTS worker failed request" << id << error;
+        }
+        emit finished(id, ok, error);
+    }
+}
+
+void TtsWorkerBackend::onReadyReadError()
+{
+    QByteArray errors = process.readAllStandardError();
+    if (!errors.trimmed().isEmpty()) {
+        qDebug() << "TTS worker errors:" << errors.trimmed();
+    }
+}
+
+void TtsWorkerBackend::onFinished()
+{
+    qWarning() << "TTS worker exited with code" << process.exitCode();
+    failPending("Generator worker exited");
+}
+
+void TtsWorkerBackend::onErrorOccurred(QProcess::ProcessError error)
+{
+    // A process that never started does not emit finished()
+    if (error == QProcess::FailedToStart) {
+        qWarning() << "TTS worker failed to start";
+        failPending("Generator worker failed to start");
+    }
+}
+
+void TtsWorkerBackend::onTimeout()
+{
+    qWarning() << "TTS worker did not answer in" << TTS_WORKER_TIMEOUT << "ms, restarting it";
+    process.kill(); // pending requests fail in onFinished, the next request starts a new worker
+}
+
+void TtsWorkerBackend::failPending(const QString &error)
+{
+    watchdog.stop();
+    QList<quint64> failed = pending;
+    pending.clear();
+    for (quint64 id : failed) {
+        emit finished(id, false, error);
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef TTSWORKERBACKEND_H
+#define TTSWORKERBACKEND_H
+
+#include "ttsbackend.h"
+#include <QtCore/QProcess>
+#include <QtCore/QTimer>
+#include <QtCore/QList>
+
+#define TTS_WORKER_TIMEOUT 30000 // ms without an answer before the worker is restarted
+
+// Keeps one "generator.py --serve" process running and talks to it over stdin/stdout,
+// one JSON object per line:
+//   request:  {"id": 1, "text": "...", "dir": "audiofiles/project", "name": "cue"}
+//   response: {"id": 1, "ok": true} or {"id": 1, "ok": false, "error": "..."}
+// The worker keeps its HTTP session open, so a cue costs one request instead of a bash fork,
+// a Python start-up and a new connection. It is started on the first request and again after a crash.
+class TtsWorkerBackend : public TtsBackend
+{
+    Q_OBJECT
+public:
+    explicit TtsWorkerBackend(const QString &audioDir, QObject *parent = nullptr);
+    ~TtsWorkerBackend() override;
+
+    QString name() const override;
+    quint64 generate(const QString &text, const QString &subdir, const QString &fileName) override;
+
+private Q_SLOTS:
+    void onReadyRead();
+    void onReadyReadError();
+    void onFinished();
+    void onErrorOccurred(QProcess::ProcessError error);
+    void onTimeout();
+
+private:
+    void ensureStarted();
+    void failPending(const QString &error);
+
+    QProcess process;
+    QTimer watchdog;
+    QList<quint64> pending; // answered in order
+};
+
+#endif //TTSWORKERBACKEND_H